@@ -1,5 +1,497 @@
 #include "dea.h"
 #include <string.h>
+#include <stdatomic.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define DEA_X86_64 1
+#else
+#define DEA_X86_64 0
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DEA_X86 1
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#else
+#define DEA_X86 0
+#endif
+
+// Per-function instruction set selection, so one binary carries every kernel
+#if defined(__GNUC__) || defined(__clang__)
+#define DEA_TARGET(isa) __attribute__((target(isa)))
+#define DEA_COMPILER_BARRIER() __asm__ volatile ("" ::: "memory")
+#else
+#define DEA_TARGET(isa)
+#define DEA_COMPILER_BARRIER() _ReadWriteBarrier()
+#endif
+
+// Bytes processed per kernel iteration. 192 is a multiple of every key
+// period (1-4) and of the 64-byte vector width, so the key pattern for a
+// stride is the same for every stride and can stay in registers.
+#define DEA_STRIDE 192
+
+// XOR `strides` * DEA_STRIDE bytes of `in` against the key pattern `ks`.
+// `out` is 64-byte aligned, `in` and `ks` may have any alignment and `in`
+// may be equal to `out`.
+typedef void (*dea_kernel_fn)(const uint8_t *in, uint8_t *out, size_t strides, const uint8_t *ks);
+
+// Same as dea_kernel_fn, but each ciphertext vector is read back from `out`
+// right after it is stored (a compiler barrier forces the reload while the
+// line is still in L1) and decrypted against the plaintext still held in
+// registers. Returns the byte index of the first round-trip mismatch, or
+// strides * DEA_STRIDE if every byte verified.
+typedef size_t (*dea_verify_fn)(const uint8_t *in, uint8_t *out, size_t strides, const uint8_t *ks);
+
+// Distance ahead of the loads at which streaming kernels prefetch the input
+#define DEA_PREFETCH_DISTANCE 256
+
+typedef struct {
+    const char *name;
+    dea_kernel_fn xor_stride;
+    dea_verify_fn xor_verify_stride;
+    dea_kernel_fn xor_stream_stride;   // Non-temporal stores, for buffers larger than the LLC
+} dea_kernel;
+
+// Index of the first non-zero byte of a mismatch vector (slow path only)
+static size_t dea_first_nonzero(const uint8_t *bytes, size_t length) {
+    size_t i = 0;
+    while (i < length && bytes[i] == 0) {
+        i++;
+    }
+    return i;
+}
+
+// Portable fallback, 8 bytes at a time
+static void dea_xor_scalar(const uint8_t *in, uint8_t *out, size_t strides, const uint8_t *ks) {
+    for (size_t s = 0; s < strides; s++) {
+        for (size_t i = 0; i < DEA_STRIDE; i += 8) {
+            uint64_t word, key;
+            memcpy(&word, in + i, 8);
+            memcpy(&key, ks + i, 8);
+            word ^= key;
+            memcpy(out + i, &word, 8);
+        }
+        in += DEA_STRIDE;
+        out += DEA_STRIDE;
+    }
+}
+
+static size_t dea_xor_verify_scalar(const uint8_t *in, uint8_t *out, size_t strides, const uint8_t *ks) {
+    size_t total = strides * DEA_STRIDE;
+    size_t first = total;
+    for (size_t i = 0; i < total; i += 8) {
+        uint64_t word, key, cipher;
+        memcpy(&word, in + i, 8);
+        memcpy(&key, ks + i % DEA_STRIDE, 8);
+        cipher = word ^ key;
+        memcpy(out + i, &cipher, 8);
+        DEA_COMPILER_BARRIER();
+        memcpy(&cipher, out + i, 8);
+        uint64_t diff = cipher ^ key ^ word;
+        if (diff && first == total) {
+            uint8_t bytes[8];
+            memcpy(bytes, &diff, 8);
+            first = i + dea_first_nonzero(bytes, 8);
+        }
+    }
+    return first;
+}
+
+#if DEA_X86
+// The streaming kernels below store with non-temporal hints so the output
+// bypasses the cache instead of evicting the working set, and prefetch the
+// input with NTA. They end with an sfence so the weakly ordered stores are
+// visible before the caller (or another thread) reads the output.
+DEA_TARGET("sse2")
+static void dea_xor_stream_sse2(const uint8_t *in, uint8_t *out, size_t strides, const uint8_t *ks) {
+    __m128i k[12];
+    for (int v = 0; v < 12; v++) {
+        k[v] = _mm_loadu_si128((const __m128i*)(ks + 16 * v));
+    }
+    for (size_t s = 0; s < strides; s++) {
+        for (int line = 0; line < DEA_STRIDE; line += 64) {
+            _mm_prefetch((const char*)(in + line + DEA_PREFETCH_DISTANCE), _MM_HINT_NTA);
+        }
+        for (int v = 0; v < 12; v++) {
+            __m128i d = _mm_loadu_si128((const __m128i*)(in + 16 * v));
+            _mm_stream_si128((__m128i*)(out + 16 * v), _mm_xor_si128(d, k[v]));
+        }
+        in += DEA_STRIDE;
+        out += DEA_STRIDE;
+    }
+    _mm_sfence();
+}
+
+DEA_TARGET("avx2")
+static void dea_xor_stream_avx2(const uint8_t *in, uint8_t *out, size_t strides, const uint8_t *ks) {
+    __m256i k[6];
+    for (int v = 0; v < 6; v++) {
+        k[v] = _mm256_loadu_si256((const __m256i*)(ks + 32 * v));
+    }
+    for (size_t s = 0; s < strides; s++) {
+        for (int line = 0; line < DEA_STRIDE; line += 64) {
+            _mm_prefetch((const char*)(in + line + DEA_PREFETCH_DISTANCE), _MM_HINT_NTA);
+        }
+        for (int v = 0; v < 6; v++) {
+            __m256i d = _mm256_loadu_si256((const __m256i*)(in + 32 * v));
+            _mm256_stream_si256((__m256i*)(out + 32 * v), _mm256_xor_si256(d, k[v]));
+        }
+        in += DEA_STRIDE;
+        out += DEA_STRIDE;
+    }
+    _mm_sfence();
+}
+
+DEA_TARGET("avx512f")
+static void dea_xor_stream_avx512(const uint8_t *in, uint8_t *out, size_t strides, const uint8_t *ks) {
+    __m512i k[3];
+    for (int v = 0; v < 3; v++) {
+        k[v] = _mm512_loadu_si512((const void*)(ks + 64 * v));
+    }
+    for (size_t s = 0; s < strides; s++) {
+        for (int v = 0; v < 3; v++) {
+            _mm_prefetch((const char*)(in + 64 * v + DEA_PREFETCH_DISTANCE), _MM_HINT_NTA);
+            __m512i d = _mm512_loadu_si512((const void*)(in + 64 * v));
+            _mm512_stream_si512((void*)(out + 64 * v), _mm512_xor_si512(d, k[v]));
+        }
+        in += DEA_STRIDE;
+        out += DEA_STRIDE;
+    }
+    _mm_sfence();
+}
+
+DEA_TARGET("sse2")
+static void dea_xor_sse2(const uint8_t *in, uint8_t *out, size_t strides, const uint8_t *ks) {
+    __m128i k[12];
+    for (int v = 0; v < 12; v++) {
+        k[v] = _mm_loadu_si128((const __m128i*)(ks + 16 * v));
+    }
+    for (size_t s = 0; s < strides; s++) {
+        for (int v = 0; v < 12; v++) {
+            __m128i d = _mm_loadu_si128((const __m128i*)(in + 16 * v));
+            _mm_store_si128((__m128i*)(out + 16 * v), _mm_xor_si128(d, k[v]));
+        }
+        in += DEA_STRIDE;
+        out += DEA_STRIDE;
+    }
+}
+
+DEA_TARGET("sse2")
+static size_t dea_xor_verify_sse2(const uint8_t *in, uint8_t *out, size_t strides, const uint8_t *ks) {
+    size_t total = strides * DEA_STRIDE;
+    size_t first = total;
+    __m128i k[12];
+    for (int v = 0; v < 12; v++) {
+        k[v] = _mm_loadu_si128((const __m128i*)(ks + 16 * v));
+    }
+    for (size_t pos = 0; pos < total; pos += DEA_STRIDE) {
+        for (int v = 0; v < 12; v++) {
+            size_t at = pos + 16 * v;
+            __m128i d = _mm_loadu_si128((const __m128i*)(in + at));
+            _mm_store_si128((__m128i*)(out + at), _mm_xor_si128(d, k[v]));
+            DEA_COMPILER_BARRIER();
+            __m128i diff = _mm_xor_si128(_mm_xor_si128(_mm_load_si128((const __m128i*)(out + at)), k[v]), d);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xFFFF && first == total) {
+                DEA_ALIGNED(16) uint8_t bytes[16];
+                _mm_store_si128((__m128i*)bytes, diff);
+                first = at + dea_first_nonzero(bytes, 16);
+            }
+        }
+    }
+    return first;
+}
+
+DEA_TARGET("avx2")
+static void dea_xor_avx2(const uint8_t *in, uint8_t *out, size_t strides, const uint8_t *ks) {
+    __m256i k[6];
+    for (int v = 0; v < 6; v++) {
+        k[v] = _mm256_loadu_si256((const __m256i*)(ks + 32 * v));
+    }
+    for (size_t s = 0; s < strides; s++) {
+        for (int v = 0; v < 6; v++) {
+            __m256i d = _mm256_loadu_si256((const __m256i*)(in + 32 * v));
+            _mm256_store_si256((__m256i*)(out + 32 * v), _mm256_xor_si256(d, k[v]));
+        }
+        in += DEA_STRIDE;
+        out += DEA_STRIDE;
+    }
+}
+
+DEA_TARGET("avx2")
+static size_t dea_xor_verify_avx2(const uint8_t *in, uint8_t *out, size_t strides, const uint8_t *ks) {
+    size_t total = strides * DEA_STRIDE;
+    size_t first = total;
+    __m256i k[6];
+    for (int v = 0; v < 6; v++) {
+        k[v] = _mm256_loadu_si256((const __m256i*)(ks + 32 * v));
+    }
+    for (size_t pos = 0; pos < total; pos += DEA_STRIDE) {
+        for (int v = 0; v < 6; v++) {
+            size_t at = pos + 32 * v;
+            __m256i d = _mm256_loadu_si256((const __m256i*)(in + at));
+            _mm256_store_si256((__m256i*)(out + at), _mm256_xor_si256(d, k[v]));
+            DEA_COMPILER_BARRIER();
+            __m256i diff = _mm256_xor_si256(_mm256_xor_si256(_mm256_load_si256((const __m256i*)(out + at)), k[v]), d);
+            if (!_mm256_testz_si256(diff, diff) && first == total) {
+                DEA_ALIGNED(32) uint8_t bytes[32];
+                _mm256_store_si256((__m256i*)bytes, diff);
+                first = at + dea_first_nonzero(bytes, 32);
+            }
+        }
+    }
+    return first;
+}
+
+DEA_TARGET("avx512f")
+static void dea_xor_avx512(const uint8_t *in, uint8_t *out, size_t strides, const uint8_t *ks) {
+    __m512i k0 = _mm512_loadu_si512((const void*)ks);
+    __m512i k1 = _mm512_loadu_si512((const void*)(ks + 64));
+    __m512i k2 = _mm512_loadu_si512((const void*)(ks + 128));
+    for (size_t s = 0; s < strides; s++) {
+        _mm512_store_si512((void*)out, _mm512_xor_si512(_mm512_loadu_si512((const void*)in), k0));
+        _mm512_store_si512((void*)(out + 64), _mm512_xor_si512(_mm512_loadu_si512((const void*)(in + 64)), k1));
+        _mm512_store_si512((void*)(out + 128), _mm512_xor_si512(_mm512_loadu_si512((const void*)(in + 128)), k2));
+        in += DEA_STRIDE;
+        out += DEA_STRIDE;
+    }
+}
+
+DEA_TARGET("avx512f")
+static size_t dea_xor_verify_avx512(const uint8_t *in, uint8_t *out, size_t strides, const uint8_t *ks) {
+    size_t total = strides * DEA_STRIDE;
+    size_t first = total;
+    __m512i k[3];
+    for (int v = 0; v < 3; v++) {
+        k[v] = _mm512_loadu_si512((const void*)(ks + 64 * v));
+    }
+    for (size_t pos = 0; pos < total; pos += DEA_STRIDE) {
+        for (int v = 0; v < 3; v++) {
+            size_t at = pos + 64 * v;
+            __m512i d = _mm512_loadu_si512((const void*)(in + at));
+            _mm512_store_si512((void*)(out + at), _mm512_xor_si512(d, k[v]));
+            DEA_COMPILER_BARRIER();
+            __m512i diff = _mm512_xor_si512(_mm512_xor_si512(_mm512_load_si512((const void*)(out + at)), k[v]), d);
+            if (_mm512_test_epi64_mask(diff, diff) && first == total) {
+                DEA_ALIGNED(64) uint8_t bytes[64];
+                _mm512_store_si512((void*)bytes, diff);
+                first = at + dea_first_nonzero(bytes, 64);
+            }
+        }
+    }
+    return first;
+}
+#endif
+
+static const dea_kernel dea_kernels[] = {
+    { "scalar", dea_xor_scalar, dea_xor_verify_scalar, dea_xor_scalar },
+#if DEA_X86
+    { "sse2", dea_xor_sse2, dea_xor_verify_sse2, dea_xor_stream_sse2 },
+    { "avx2", dea_xor_avx2, dea_xor_verify_avx2, dea_xor_stream_avx2 },
+    { "avx512", dea_xor_avx512, dea_xor_verify_avx512, dea_xor_stream_avx512 },
+#endif
+};
+
+#if DEA_X86
+static void dea_cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+#ifdef _WIN32
+    int r[4];
+    __cpuidex(r, (int)leaf, (int)subleaf);
+    for (int i = 0; i < 4; i++) regs[i] = (unsigned)r[i];
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Extended register state the OS saves on context switch (XCR0)
+static uint64_t dea_xgetbv(void) {
+#ifdef _WIN32
+    return _xgetbv(0);
+#else
+    unsigned lo, hi;
+    __asm__ volatile ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((uint64_t)hi << 32) | lo;
+#endif
+}
+#endif
+
+// Pick the widest kernel this CPU and OS support
+static const dea_kernel *dea_detect_kernel(void) {
+    const dea_kernel *best = &dea_kernels[0];
+#if DEA_X86
+    unsigned regs[4];
+    dea_cpuid(0, 0, regs);
+    unsigned max_leaf = regs[0];
+
+    dea_cpuid(1, 0, regs);
+    if (regs[3] & (1u << 26)) {                 // SSE2
+        best = &dea_kernels[1];
+    }
+    int osxsave = (regs[2] & (1u << 27)) != 0;  // OS uses XSAVE/XGETBV
+    if (osxsave && max_leaf >= 7) {
+        uint64_t xcr0 = dea_xgetbv();
+        dea_cpuid(7, 0, regs);
+        if ((xcr0 & 0x6) == 0x6 && (regs[1] & (1u << 5))) {            // YMM state + AVX2
+            best = &dea_kernels[2];
+        }
+        if ((xcr0 & 0xE6) == 0xE6 && (regs[1] & (1u << 16))) {          // ZMM state + AVX-512F
+            best = &dea_kernels[3];
+        }
+    }
+#endif
+    return best;
+}
+
+static const dea_kernel *volatile dea_active_kernel = NULL;
+
+// Resolve the kernel once. DEA_KERNEL=<name> forces a specific kernel
+// (e.g. for benchmarking), as long as the CPU supports it.
+static const dea_kernel *dea_get_kernel(void) {
+    const dea_kernel *kernel = dea_active_kernel;
+    if (kernel) {
+        return kernel;
+    }
+
+    kernel = dea_detect_kernel();
+    const char *forced = getenv("DEA_KERNEL");
+    if (forced) {
+        for (const dea_kernel *k = dea_kernels; k <= kernel; k++) {
+            if (strcmp(k->name, forced) == 0) {
+                kernel = k;
+                break;
+            }
+        }
+    }
+
+    dea_active_kernel = kernel;
+    return kernel;
+}
+
+// Name of the encryption kernel selected for this CPU
+const char *dea_kernel_name(void) {
+    return dea_get_kernel()->name;
+}
+
+// Size of the largest (last-level) cache from the CPUID cache descriptors
+// (leaf 4 on Intel, 0x8000001D on AMD), or 0 if it cannot be determined
+static size_t dea_detect_llc(void) {
+    size_t largest = 0;
+#if DEA_X86
+    unsigned regs[4];
+    unsigned leaves[2] = { 4, 0x8000001D };
+    unsigned max_leaf[2];
+    dea_cpuid(0, 0, regs);
+    max_leaf[0] = regs[0];
+    dea_cpuid(0x80000000, 0, regs);
+    max_leaf[1] = regs[0];
+
+    for (int l = 0; l < 2 && largest == 0; l++) {
+        if (max_leaf[l] < leaves[l]) {
+            continue;
+        }
+        for (unsigned sub = 0; sub < 16; sub++) {
+            dea_cpuid(leaves[l], sub, regs);
+            if ((regs[0] & 0x1F) == 0) {            // No more caches
+                break;
+            }
+            size_t ways = (regs[1] >> 22) + 1;
+            size_t partitions = ((regs[1] >> 12) & 0x3FF) + 1;
+            size_t line = (regs[1] & 0xFFF) + 1;
+            size_t sets = (size_t)regs[2] + 1;
+            size_t bytes = ways * partitions * line * sets;
+            if (bytes > largest) {
+                largest = bytes;
+            }
+        }
+    }
+#endif
+    return largest;
+}
+
+static volatile size_t dea_stream_threshold = 0;
+
+// Buffers of at least this many bytes are written with non-temporal stores
+// by DEA_STORE_AUTO: once a buffer is larger than the last-level cache its
+// output would be evicted before it is read again anyway, so caching it only
+// pushes out everyone else's data. DEA_NT_THRESHOLD=<bytes> overrides it.
+size_t dea_streaming_threshold(void) {
+    size_t threshold = dea_stream_threshold;
+    if (threshold) {
+        return threshold;
+    }
+
+    const char *forced = getenv("DEA_NT_THRESHOLD");
+    if (forced && strtoull(forced, NULL, 10) > 0) {
+        threshold = (size_t)strtoull(forced, NULL, 10);
+    } else {
+        threshold = dea_detect_llc();
+        if (threshold == 0) {
+            threshold = 8 * 1024 * 1024;
+        }
+    }
+    dea_stream_threshold = threshold;
+    return threshold;
+}
+
+// Resolve DEA_STORE_AUTO for a buffer of `length` bytes
+static int dea_use_streaming(int store_mode, size_t length) {
+    if (store_mode == DEA_STORE_AUTO) {
+        return length >= dea_streaming_threshold();
+    }
+    return store_mode == DEA_STORE_STREAMING;
+}
+
+// XOR `length` bytes with the key sequence, starting at key index `phase`.
+// `keystream`, if given, is the expanded key sequence starting at key index
+// 0 and at least DEA_STRIDE + period bytes long. `streaming` selects the
+// non-temporal kernel. Returns the key index following the last byte.
+// `data` and `output` may be the same buffer.
+static unsigned dea_crypt_phase(const uint8_t *keys, unsigned period, const uint8_t *keystream,
+                                unsigned phase, const uint8_t *data, size_t length, uint8_t *output,
+                                int streaming) {
+    size_t i = 0;
+
+    // Scalar head until the output is 64-byte aligned; short blocks never leave it
+    size_t head = (64 - ((uintptr_t)output & 63)) & 63;
+    if (length < head + DEA_STRIDE) {
+        head = length;
+    }
+    for (; i < head; i++) {
+        output[i] = data[i] ^ keys[phase];
+        if (++phase == period) phase = 0;
+    }
+
+    // Vector body. The stride is a multiple of the period, so the phase is unchanged.
+    size_t strides = (length - i) / DEA_STRIDE;
+    if (strides) {
+        DEA_ALIGNED(64) uint8_t ks[DEA_STRIDE];
+        if (keystream) {
+            keystream += phase;
+        } else {
+            for (unsigned k = 0; k < DEA_STRIDE; k++) {
+                ks[k] = keys[(phase + k) % period];
+            }
+            keystream = ks;
+        }
+        const dea_kernel *kernel = dea_get_kernel();
+        if (streaming) {
+            kernel->xor_stream_stride(data + i, output + i, strides, keystream);
+        } else {
+            kernel->xor_stride(data + i, output + i, strides, keystream);
+        }
+        i += strides * DEA_STRIDE;
+    }
+
+    // Scalar tail
+    for (; i < length; i++) {
+        output[i] = data[i] ^ keys[phase];
+        if (++phase == period) phase = 0;
+    }
+    return phase;
+}
 
 // Initialize the DEA
 void dea_init(DEA *dea) {
@@ -63,9 +555,24 @@ uint8_t dea_encrypt_byte(DEA *dea, uint8_t data_in) {
 
 // Encrypt a block of data
 void dea_encrypt_block(DEA *dea, uint8_t *data, size_t length, uint8_t *output) {
-    for (size_t i = 0; i < length; i++) {
-        output[i] = dea_encrypt_byte(dea, data[i]);
+    if (!dea->initialized) {
+        dea_init(dea);
+    }
+    
+    // No encryption if no keys are set
+    if (dea->num_keys == 0) {
+        memmove(output, data, length);
+        return;
     }
+    
+    if (length == 0) {
+        return;
+    }
+    
+    dea->key_counter = (uint8_t)dea_crypt_phase(dea->keys, dea->num_keys, NULL, dea->key_counter,
+                                                data, length, output,
+                                                dea_use_streaming(DEA_STORE_AUTO, length));
+    dea->dout = output[length - 1];
 }
 
 // Decrypt function - for XOR encryption, we need to reset the key counter
@@ -77,4 +584,760 @@ void dea_decrypt_block(DEA *dea, uint8_t *data, size_t length, uint8_t *output)
     // For XOR encryption, encryption and decryption are the same operation
     // Just apply the encryption algorithm with the current key counter
     dea_encrypt_block(dea, data, length, output);
-}
\ No newline at end of file
+}
+
+// Build a plan from up to 4 keys. With no keys the plan is the identity
+// transform, matching dea_encrypt_byte. Returns 0 if num_keys is out of range.
+int dea_plan_init(DEA_Plan *plan, const uint8_t *keys, int num_keys) {
+    if (num_keys < 0 || num_keys > DEA_MAX_KEYS) {
+        return 0;
+    }
+    
+    memset(plan->keys, 0, sizeof(plan->keys));
+    if (num_keys > 0) {
+        memcpy(plan->keys, keys, (size_t)num_keys);
+    }
+    plan->num_keys = (uint8_t)num_keys;
+    plan->period = (uint8_t)(num_keys > 0 ? num_keys : 1);
+    
+    // Expand the key sequence over the whole keystream
+    for (int i = 0; i < DEA_KEYSTREAM_BYTES; i++) {
+        plan->keystream[i] = plan->keys[i % plan->period];
+    }
+    
+    return 1;
+}
+
+// Allocate and build a plan (cache-line aligned). Returns NULL on failure.
+DEA_Plan *dea_plan_create(const uint8_t *keys, int num_keys) {
+#ifdef _WIN32
+    DEA_Plan *plan = (DEA_Plan*)_aligned_malloc(sizeof(DEA_Plan), 64);
+#else
+    DEA_Plan *plan = (DEA_Plan*)aligned_alloc(64, sizeof(DEA_Plan));
+#endif
+    if (!plan) {
+        return NULL;
+    }
+    
+    if (!dea_plan_init(plan, keys, num_keys)) {
+        dea_plan_destroy(plan);
+        return NULL;
+    }
+    
+    return plan;
+}
+
+void dea_plan_destroy(DEA_Plan *plan) {
+#ifdef _WIN32
+    _aligned_free(plan);
+#else
+    free(plan);
+#endif
+}
+
+// 64-bit FNV-1a hash of the key count and keys. Files record it so a reader
+// can tell whether a plan matches the keys the data was encrypted with
+// without storing the keys themselves.
+uint64_t dea_plan_fingerprint(const DEA_Plan *plan) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = (hash ^ plan->num_keys) * 0x100000001b3ULL;
+    for (int i = 0; i < plan->num_keys; i++) {
+        hash = (hash ^ plan->keys[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Encrypt or decrypt (the same XOR operation) `length` bytes that sit at
+// absolute `offset` in the stream. The key phase is derived from the offset
+// in O(1), so any range can be processed independently of the others.
+// `data` and `output` may be the same buffer. Buffers of at least
+// dea_streaming_threshold() bytes are written with non-temporal stores.
+void dea_crypt_at(const DEA_Plan *plan, uint64_t offset, const uint8_t *data, size_t length, uint8_t *output) {
+    dea_crypt_at_store(plan, offset, data, length, output, DEA_STORE_AUTO);
+}
+
+// dea_crypt_at with an explicit store policy: DEA_STORE_CACHED,
+// DEA_STORE_STREAMING (non-temporal stores, output not left in cache) or
+// DEA_STORE_AUTO. Callers that split one large buffer into pieces resolve
+// AUTO against the whole buffer and pass the result down.
+void dea_crypt_at_store(const DEA_Plan *plan, uint64_t offset, const uint8_t *data, size_t length,
+                        uint8_t *output, int store_mode) {
+    dea_crypt_phase(plan->keys, plan->period, plan->keystream,
+                    (unsigned)(offset % plan->period), data, length, output,
+                    dea_use_streaming(store_mode, length));
+}
+
+// Scalar encrypt-and-verify of bytes [begin, end), advancing `phase`.
+// Returns the first mismatching index, or `first` if there is none.
+static size_t dea_crypt_verify_bytes(const uint8_t *keys, unsigned period, unsigned *phase,
+                                     const uint8_t *data, uint8_t *output,
+                                     size_t begin, size_t end, size_t first) {
+    unsigned k = *phase;
+    for (size_t i = begin; i < end; i++) {
+        uint8_t plain = data[i];
+        output[i] = plain ^ keys[k];
+        DEA_COMPILER_BARRIER();
+        if ((uint8_t)(output[i] ^ keys[k]) != plain && i < first) {
+            first = i;
+        }
+        if (++k == period) k = 0;
+    }
+    *phase = k;
+    return first;
+}
+
+// Encrypt `length` bytes at stream `offset` and verify the round trip in the
+// same pass: each ciphertext vector is read back right after it is written,
+// while still in L1, and decrypted against the plaintext held in registers.
+// This replaces a separate decrypt pass and memcmp. Returns the index
+// (relative to `data`) of the first byte that does not round-trip, or
+// `length` if every byte verified. `data` and `output` may be the same buffer.
+size_t dea_encrypt_verified(const DEA_Plan *plan, uint64_t offset, const uint8_t *data, size_t length, uint8_t *output) {
+    unsigned period = plan->period;
+    unsigned phase = (unsigned)(offset % period);
+    size_t first = length;
+    size_t i = 0;
+    
+    // Scalar head until the output is 64-byte aligned; short blocks never leave it
+    size_t head = (64 - ((uintptr_t)output & 63)) & 63;
+    if (length < head + DEA_STRIDE) {
+        head = length;
+    }
+    first = dea_crypt_verify_bytes(plan->keys, period, &phase, data, output, 0, head, first);
+    i = head;
+    
+    // Vector body
+    size_t strides = (length - i) / DEA_STRIDE;
+    if (strides) {
+        size_t bad = dea_get_kernel()->xor_verify_stride(data + i, output + i, strides, plan->keystream + phase);
+        if (bad != strides * DEA_STRIDE && i + bad < first) {
+            first = i + bad;
+        }
+        i += strides * DEA_STRIDE;
+    }
+    
+    // Scalar tail
+    return dea_crypt_verify_bytes(plan->keys, period, &phase, data, output, i, length, first);
+}
+
+// Smallest chunk granularity that keeps every chunk start at key phase 0
+// and on an `align`-byte boundary: lcm(num_keys, align)
+size_t dea_partition_quantum(int num_keys, size_t align) {
+    size_t period = num_keys > 0 ? (size_t)num_keys : 1;
+    size_t a = period, b = align > 0 ? align : 1;
+    while (b) {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return period / a * (align > 0 ? align : 1);
+}
+
+// Split `n_bytes` between `n_workers` in proportion to `weights` (NULL for
+// equal shares). bounds[0..n_workers] receives the chunk boundaries: worker
+// i gets [bounds[i], bounds[i + 1]). Every boundary except the final one is a
+// multiple of dea_partition_quantum, so each chunk starts at key phase 0 and,
+// for an aligned buffer, on an aligned address. The last worker also takes
+// the sub-quantum remainder; chunks may be empty for tiny inputs.
+// Returns 0 on invalid arguments.
+int dea_partition_weighted(size_t n_bytes, int n_workers, int num_keys, size_t align,
+                           const double *weights, size_t *bounds) {
+    if (n_workers <= 0) {
+        return 0;
+    }
+    
+    double total_weight = 0.0;
+    for (int i = 0; i < n_workers; i++) {
+        double weight = weights ? weights[i] : 1.0;
+        if (weight < 0.0) {
+            return 0;
+        }
+        total_weight += weight;
+    }
+    if (total_weight <= 0.0) {
+        return 0;
+    }
+    
+    size_t quantum = dea_partition_quantum(num_keys, align);
+    size_t units = n_bytes / quantum;
+    
+    // Place each boundary at the cumulative weight, rounded to whole quanta
+    double cumulative = 0.0;
+    bounds[0] = 0;
+    for (int i = 1; i < n_workers; i++) {
+        cumulative += weights ? weights[i - 1] : 1.0;
+        size_t unit = (size_t)((double)units * (cumulative / total_weight) + 0.5);
+        if (unit > units) unit = units;
+        bounds[i] = unit * quantum;
+        if (bounds[i] < bounds[i - 1]) bounds[i] = bounds[i - 1];
+    }
+    bounds[n_workers] = n_bytes;
+    
+    return 1;
+}
+
+// Equal-share dea_partition_weighted
+int dea_partition(size_t n_bytes, int n_workers, int num_keys, size_t align, size_t *bounds) {
+    return dea_partition_weighted(n_bytes, n_workers, num_keys, align, NULL, bounds);
+}
+
+// Position a cursor at an absolute stream offset
+void dea_cursor_init(DEA_Cursor *cursor, const DEA_Plan *plan, uint64_t offset) {
+    cursor->plan = plan;
+    cursor->offset = offset;
+}
+
+// Encrypt or decrypt (the same XOR operation) the next `length` bytes of the
+// stream and advance the cursor. `data` and `output` may be the same buffer.
+void dea_cursor_crypt(DEA_Cursor *cursor, const uint8_t *data, size_t length, uint8_t *output) {
+    dea_crypt_at(cursor->plan, cursor->offset, data, length, output);
+    cursor->offset += length;
+}
+
+// CRC32C (Castagnoli, reflected polynomial 0x82F63B78) used for the fused
+// integrity digests. CRC values passed in and out are finalized, so a CRC
+// can be continued across calls like zlib's crc32(): start from 0.
+#define DEA_CRC32C_POLY 0x82F63B78u
+
+// Byte-at-a-time table for DEA_CRC32C_POLY: entry n is the CRC of n shifted
+// through 8 rounds. Constant, so every thread can use it without setup.
+static const uint32_t dea_crc_table[256] = {
+    0x00000000u, 0xF26B8303u, 0xE13B70F7u, 0x1350F3F4u, 0xC79A971Fu, 0x35F1141Cu, 0x26A1E7E8u, 0xD4CA64EBu,
+    0x8AD958CFu, 0x78B2DBCCu, 0x6BE22838u, 0x9989AB3Bu, 0x4D43CFD0u, 0xBF284CD3u, 0xAC78BF27u, 0x5E133C24u,
+    0x105EC76Fu, 0xE235446Cu, 0xF165B798u, 0x030E349Bu, 0xD7C45070u, 0x25AFD373u, 0x36FF2087u, 0xC494A384u,
+    0x9A879FA0u, 0x68EC1CA3u, 0x7BBCEF57u, 0x89D76C54u, 0x5D1D08BFu, 0xAF768BBCu, 0xBC267848u, 0x4E4DFB4Bu,
+    0x20BD8EDEu, 0xD2D60DDDu, 0xC186FE29u, 0x33ED7D2Au, 0xE72719C1u, 0x154C9AC2u, 0x061C6936u, 0xF477EA35u,
+    0xAA64D611u, 0x580F5512u, 0x4B5FA6E6u, 0xB93425E5u, 0x6DFE410Eu, 0x9F95C20Du, 0x8CC531F9u, 0x7EAEB2FAu,
+    0x30E349B1u, 0xC288CAB2u, 0xD1D83946u, 0x23B3BA45u, 0xF779DEAEu, 0x05125DADu, 0x1642AE59u, 0xE4292D5Au,
+    0xBA3A117Eu, 0x4851927Du, 0x5B016189u, 0xA96AE28Au, 0x7DA08661u, 0x8FCB0562u, 0x9C9BF696u, 0x6EF07595u,
+    0x417B1DBCu, 0xB3109EBFu, 0xA0406D4Bu, 0x522BEE48u, 0x86E18AA3u, 0x748A09A0u, 0x67DAFA54u, 0x95B17957u,
+    0xCBA24573u, 0x39C9C670u, 0x2A993584u, 0xD8F2B687u, 0x0C38D26Cu, 0xFE53516Fu, 0xED03A29Bu, 0x1F682198u,
+    0x5125DAD3u, 0xA34E59D0u, 0xB01EAA24u, 0x42752927u, 0x96BF4DCCu, 0x64D4CECFu, 0x77843D3Bu, 0x85EFBE38u,
+    0xDBFC821Cu, 0x2997011Fu, 0x3AC7F2EBu, 0xC8AC71E8u, 0x1C661503u, 0xEE0D9600u, 0xFD5D65F4u, 0x0F36E6F7u,
+    0x61C69362u, 0x93AD1061u, 0x80FDE395u, 0x72966096u, 0xA65C047Du, 0x5437877Eu, 0x4767748Au, 0xB50CF789u,
+    0xEB1FCBADu, 0x197448AEu, 0x0A24BB5Au, 0xF84F3859u, 0x2C855CB2u, 0xDEEEDFB1u, 0xCDBE2C45u, 0x3FD5AF46u,
+    0x7198540Du, 0x83F3D70Eu, 0x90A324FAu, 0x62C8A7F9u, 0xB602C312u, 0x44694011u, 0x5739B3E5u, 0xA55230E6u,
+    0xFB410CC2u, 0x092A8FC1u, 0x1A7A7C35u, 0xE811FF36u, 0x3CDB9BDDu, 0xCEB018DEu, 0xDDE0EB2Au, 0x2F8B6829u,
+    0x82F63B78u, 0x709DB87Bu, 0x63CD4B8Fu, 0x91A6C88Cu, 0x456CAC67u, 0xB7072F64u, 0xA457DC90u, 0x563C5F93u,
+    0x082F63B7u, 0xFA44E0B4u, 0xE9141340u, 0x1B7F9043u, 0xCFB5F4A8u, 0x3DDE77ABu, 0x2E8E845Fu, 0xDCE5075Cu,
+    0x92A8FC17u, 0x60C37F14u, 0x73938CE0u, 0x81F80FE3u, 0x55326B08u, 0xA759E80Bu, 0xB4091BFFu, 0x466298FCu,
+    0x1871A4D8u, 0xEA1A27DBu, 0xF94AD42Fu, 0x0B21572Cu, 0xDFEB33C7u, 0x2D80B0C4u, 0x3ED04330u, 0xCCBBC033u,
+    0xA24BB5A6u, 0x502036A5u, 0x4370C551u, 0xB11B4652u, 0x65D122B9u, 0x97BAA1BAu, 0x84EA524Eu, 0x7681D14Du,
+    0x2892ED69u, 0xDAF96E6Au, 0xC9A99D9Eu, 0x3BC21E9Du, 0xEF087A76u, 0x1D63F975u, 0x0E330A81u, 0xFC588982u,
+    0xB21572C9u, 0x407EF1CAu, 0x532E023Eu, 0xA145813Du, 0x758FE5D6u, 0x87E466D5u, 0x94B49521u, 0x66DF1622u,
+    0x38CC2A06u, 0xCAA7A905u, 0xD9F75AF1u, 0x2B9CD9F2u, 0xFF56BD19u, 0x0D3D3E1Au, 0x1E6DCDEEu, 0xEC064EEDu,
+    0xC38D26C4u, 0x31E6A5C7u, 0x22B65633u, 0xD0DDD530u, 0x0417B1DBu, 0xF67C32D8u, 0xE52CC12Cu, 0x1747422Fu,
+    0x49547E0Bu, 0xBB3FFD08u, 0xA86F0EFCu, 0x5A048DFFu, 0x8ECEE914u, 0x7CA56A17u, 0x6FF599E3u, 0x9D9E1AE0u,
+    0xD3D3E1ABu, 0x21B862A8u, 0x32E8915Cu, 0xC083125Fu, 0x144976B4u, 0xE622F5B7u, 0xF5720643u, 0x07198540u,
+    0x590AB964u, 0xAB613A67u, 0xB831C993u, 0x4A5A4A90u, 0x9E902E7Bu, 0x6CFBAD78u, 0x7FAB5E8Cu, 0x8DC0DD8Fu,
+    0xE330A81Au, 0x115B2B19u, 0x020BD8EDu, 0xF0605BEEu, 0x24AA3F05u, 0xD6C1BC06u, 0xC5914FF2u, 0x37FACCF1u,
+    0x69E9F0D5u, 0x9B8273D6u, 0x88D28022u, 0x7AB90321u, 0xAE7367CAu, 0x5C18E4C9u, 0x4F48173Du, 0xBD23943Eu,
+    0xF36E6F75u, 0x0105EC76u, 0x12551F82u, 0xE03E9C81u, 0x34F4F86Au, 0xC69F7B69u, 0xD5CF889Du, 0x27A40B9Eu,
+    0x79B737BAu, 0x8BDCB4B9u, 0x988C474Du, 0x6AE7C44Eu, 0xBE2DA0A5u, 0x4C4623A6u, 0x5F16D052u, 0xAD7D5351u
+};
+
+// -1 unresolved, 0 table, 1 SSE4.2 crc32. Atomic because pool workers may
+// resolve it at the same time; they all compute the same value.
+static _Atomic int dea_crc_mode = -1;
+
+// Use the SSE4.2 crc32 instruction when the CPU has it, unless
+// DEA_KERNEL=scalar forced the portable code paths
+static int dea_crc_hardware(void) {
+    int mode = atomic_load_explicit(&dea_crc_mode, memory_order_acquire);
+    if (mode >= 0) {
+        return mode;
+    }
+
+    mode = 0;
+#if DEA_X86_64
+    unsigned regs[4];
+    dea_cpuid(1, 0, regs);
+    if ((regs[2] & (1u << 20)) && strcmp(dea_get_kernel()->name, "scalar") != 0) {
+        mode = 1;
+    }
+#endif
+    atomic_store_explicit(&dea_crc_mode, mode, memory_order_release);
+    return mode;
+}
+
+// Fused encrypt + verify + CRC32C of plaintext and ciphertext. `ks` is the
+// keystream starting at the phase of data[0]; the CRC states are raw
+// (not finalized). The ciphertext CRC is taken over the bytes read back
+// from `output`. Returns the first mismatch index, or `length`.
+static size_t dea_crypt_crc_table(const uint8_t *ks, const uint8_t *data, size_t length, uint8_t *output,
+                                  uint32_t *plain_state, uint32_t *cipher_state) {
+    uint32_t cp = *plain_state, cc = *cipher_state;
+    size_t first = length;
+    size_t kpos = 0;
+    for (size_t i = 0; i < length; i++) {
+        uint8_t plain = data[i];
+        output[i] = plain ^ ks[kpos];
+        DEA_COMPILER_BARRIER();
+        uint8_t cipher = output[i];
+        if ((uint8_t)(cipher ^ ks[kpos]) != plain && first == length) {
+            first = i;
+        }
+        cp = dea_crc_table[(cp ^ plain) & 0xFF] ^ (cp >> 8);
+        cc = dea_crc_table[(cc ^ cipher) & 0xFF] ^ (cc >> 8);
+        if (++kpos == DEA_STRIDE) kpos = 0;
+    }
+    *plain_state = cp;
+    *cipher_state = cc;
+    return first;
+}
+
+#if DEA_X86_64
+DEA_TARGET("sse4.2")
+static size_t dea_crypt_crc_sse42(const uint8_t *ks, const uint8_t *data, size_t length, uint8_t *output,
+                                  uint32_t *plain_state, uint32_t *cipher_state) {
+    uint64_t cp = *plain_state, cc = *cipher_state;
+    size_t first = length;
+    size_t kpos = 0;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word, key, cipher;
+        memcpy(&word, data + i, 8);
+        memcpy(&key, ks + kpos, 8);
+        cipher = word ^ key;
+        memcpy(output + i, &cipher, 8);
+        DEA_COMPILER_BARRIER();
+        memcpy(&cipher, output + i, 8);
+        if ((cipher ^ key) != word && first == length) {
+            uint8_t bytes[8];
+            uint64_t diff = cipher ^ key ^ word;
+            memcpy(bytes, &diff, 8);
+            first = i + dea_first_nonzero(bytes, 8);
+        }
+        cp = _mm_crc32_u64(cp, word);
+        cc = _mm_crc32_u64(cc, cipher);
+        kpos += 8;
+        if (kpos == DEA_STRIDE) kpos = 0;
+    }
+    uint32_t cp32 = (uint32_t)cp, cc32 = (uint32_t)cc;
+    for (; i < length; i++) {
+        uint8_t plain = data[i];
+        output[i] = plain ^ ks[kpos];
+        DEA_COMPILER_BARRIER();
+        uint8_t cipher = output[i];
+        if ((uint8_t)(cipher ^ ks[kpos]) != plain && first == length) {
+            first = i;
+        }
+        cp32 = _mm_crc32_u8(cp32, plain);
+        cc32 = _mm_crc32_u8(cc32, cipher);
+        kpos++;
+    }
+    *plain_state = cp32;
+    *cipher_state = cc32;
+    return first;
+}
+
+DEA_TARGET("sse4.2")
+static uint32_t dea_crc32c_sse42(uint32_t state, const uint8_t *data, size_t length) {
+    uint64_t c = state;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        c = _mm_crc32_u64(c, word);
+    }
+    uint32_t c32 = (uint32_t)c;
+    for (; i < length; i++) {
+        c32 = _mm_crc32_u8(c32, data[i]);
+    }
+    return c32;
+}
+#endif
+
+// CRC32C of `length` bytes, continuing from a previous (finalized) CRC
+uint32_t dea_crc32c(uint32_t crc, const uint8_t *data, size_t length) {
+    uint32_t state = ~crc;
+#if DEA_X86_64
+    if (dea_crc_hardware()) {
+        return ~dea_crc32c_sse42(state, data, length);
+    }
+#endif
+    for (size_t i = 0; i < length; i++) {
+        state = dea_crc_table[(state ^ data[i]) & 0xFF] ^ (state >> 8);
+    }
+    return ~state;
+}
+
+static uint32_t dea_gf2_matrix_times(const uint32_t *mat, uint32_t vec) {
+    uint32_t sum = 0;
+    while (vec) {
+        if (vec & 1) {
+            sum ^= *mat;
+        }
+        vec >>= 1;
+        mat++;
+    }
+    return sum;
+}
+
+static void dea_gf2_matrix_square(uint32_t *square, const uint32_t *mat) {
+    for (int n = 0; n < 32; n++) {
+        square[n] = dea_gf2_matrix_times(mat, mat[n]);
+    }
+}
+
+// CRC32C of the concatenation A||B from crc(A), crc(B) and len(B), by
+// applying len(B) zero bytes to crc(A) with GF(2) matrix squaring (as in
+// zlib's crc32_combine). O(log len) with no access to the data.
+uint32_t dea_crc32c_combine(uint32_t crc_a, uint32_t crc_b, uint64_t length_b) {
+    uint32_t even[32], odd[32];
+    if (length_b == 0) {
+        return crc_a;
+    }
+
+    // Operator for one zero bit
+    odd[0] = DEA_CRC32C_POLY;
+    uint32_t row = 1;
+    for (int n = 1; n < 32; n++) {
+        odd[n] = row;
+        row <<= 1;
+    }
+    dea_gf2_matrix_square(even, odd);   // two zero bits
+    dea_gf2_matrix_square(odd, even);   // four zero bits
+
+    // Apply len(B) zero bytes, one bit of the length at a time
+    do {
+        dea_gf2_matrix_square(even, odd);
+        if (length_b & 1) {
+            crc_a = dea_gf2_matrix_times(even, crc_a);
+        }
+        length_b >>= 1;
+        if (length_b == 0) {
+            break;
+        }
+        dea_gf2_matrix_square(odd, even);
+        if (length_b & 1) {
+            crc_a = dea_gf2_matrix_times(odd, crc_a);
+        }
+        length_b >>= 1;
+    } while (length_b);
+
+    return crc_a ^ crc_b;
+}
+
+void dea_digest_init(DEA_Digest *digest) {
+    digest->plain_crc = 0;
+    digest->cipher_crc = 0;
+    digest->length = 0;
+}
+
+// Append `next` (the range immediately following `digest`) to `digest`.
+// Merging per-chunk digests in stream order gives the same result as one
+// digest over the whole stream, however it was partitioned.
+void dea_digest_merge(DEA_Digest *digest, const DEA_Digest *next) {
+    digest->plain_crc = dea_crc32c_combine(digest->plain_crc, next->plain_crc, next->length);
+    digest->cipher_crc = dea_crc32c_combine(digest->cipher_crc, next->cipher_crc, next->length);
+    digest->length += next->length;
+}
+
+// Encrypt `length` bytes at stream `offset`, verify the round trip and
+// extend `digest` with the CRC32C of the plaintext and of the ciphertext,
+// all in one pass over the data. Returns the first mismatch index
+// (relative to `data`), or `length`. `data` and `output` may be the same
+// buffer.
+size_t dea_encrypt_digest(const DEA_Plan *plan, uint64_t offset, const uint8_t *data, size_t length,
+                          uint8_t *output, DEA_Digest *digest) {
+    const uint8_t *ks = plan->keystream + offset % plan->period;
+    uint32_t plain_state = ~digest->plain_crc;
+    uint32_t cipher_state = ~digest->cipher_crc;
+    size_t first;
+
+#if DEA_X86_64
+    if (dea_crc_hardware()) {
+        first = dea_crypt_crc_sse42(ks, data, length, output, &plain_state, &cipher_state);
+    } else
+#endif
+    {
+        first = dea_crypt_crc_table(ks, data, length, output, &plain_state, &cipher_state);
+    }
+
+    digest->plain_crc = ~plain_state;
+    digest->cipher_crc = ~cipher_state;
+    digest->length += length;
+    return first;
+}
+
+// ASCII decimal formatting. Every byte maps to a fixed table entry: its
+// "NNN " text padded to 4 bytes and the text length. Copying all 4 bytes
+// and advancing by the length formats a byte with one load and one store.
+// The table is constant, so pool workers share it without any setup.
+typedef struct {
+    char text[4];
+    uint32_t length;
+} DEA_DecimalEntry;
+
+static const DEA_DecimalEntry dea_decimal_table[256] = {
+    { "0 ", 2 }, { "1 ", 2 }, { "2 ", 2 }, { "3 ", 2 }, { "4 ", 2 }, { "5 ", 2 }, { "6 ", 2 }, { "7 ", 2 },
+    { "8 ", 2 }, { "9 ", 2 }, { "10 ", 3 }, { "11 ", 3 }, { "12 ", 3 }, { "13 ", 3 }, { "14 ", 3 }, { "15 ", 3 },
+    { "16 ", 3 }, { "17 ", 3 }, { "18 ", 3 }, { "19 ", 3 }, { "20 ", 3 }, { "21 ", 3 }, { "22 ", 3 }, { "23 ", 3 },
+    { "24 ", 3 }, { "25 ", 3 }, { "26 ", 3 }, { "27 ", 3 }, { "28 ", 3 }, { "29 ", 3 }, { "30 ", 3 }, { "31 ", 3 },
+    { "32 ", 3 }, { "33 ", 3 }, { "34 ", 3 }, { "35 ", 3 }, { "36 ", 3 }, { "37 ", 3 }, { "38 ", 3 }, { "39 ", 3 },
+    { "40 ", 3 }, { "41 ", 3 }, { "42 ", 3 }, { "43 ", 3 }, { "44 ", 3 }, { "45 ", 3 }, { "46 ", 3 }, { "47 ", 3 },
+    { "48 ", 3 }, { "49 ", 3 }, { "50 ", 3 }, { "51 ", 3 }, { "52 ", 3 }, { "53 ", 3 }, { "54 ", 3 }, { "55 ", 3 },
+    { "56 ", 3 }, { "57 ", 3 }, { "58 ", 3 }, { "59 ", 3 }, { "60 ", 3 }, { "61 ", 3 }, { "62 ", 3 }, { "63 ", 3 },
+    { "64 ", 3 }, { "65 ", 3 }, { "66 ", 3 }, { "67 ", 3 }, { "68 ", 3 }, { "69 ", 3 }, { "70 ", 3 }, { "71 ", 3 },
+    { "72 ", 3 }, { "73 ", 3 }, { "74 ", 3 }, { "75 ", 3 }, { "76 ", 3 }, { "77 ", 3 }, { "78 ", 3 }, { "79 ", 3 },
+    { "80 ", 3 }, { "81 ", 3 }, { "82 ", 3 }, { "83 ", 3 }, { "84 ", 3 }, { "85 ", 3 }, { "86 ", 3 }, { "87 ", 3 },
+    { "88 ", 3 }, { "89 ", 3 }, { "90 ", 3 }, { "91 ", 3 }, { "92 ", 3 }, { "93 ", 3 }, { "94 ", 3 }, { "95 ", 3 },
+    { "96 ", 3 }, { "97 ", 3 }, { "98 ", 3 }, { "99 ", 3 }, { "100 ", 4 }, { "101 ", 4 }, { "102 ", 4 }, { "103 ", 4 },
+    { "104 ", 4 }, { "105 ", 4 }, { "106 ", 4 }, { "107 ", 4 }, { "108 ", 4 }, { "109 ", 4 }, { "110 ", 4 }, { "111 ", 4 },
+    { "112 ", 4 }, { "113 ", 4 }, { "114 ", 4 }, { "115 ", 4 }, { "116 ", 4 }, { "117 ", 4 }, { "118 ", 4 }, { "119 ", 4 },
+    { "120 ", 4 }, { "121 ", 4 }, { "122 ", 4 }, { "123 ", 4 }, { "124 ", 4 }, { "125 ", 4 }, { "126 ", 4 }, { "127 ", 4 },
+    { "128 ", 4 }, { "129 ", 4 }, { "130 ", 4 }, { "131 ", 4 }, { "132 ", 4 }, { "133 ", 4 }, { "134 ", 4 }, { "135 ", 4 },
+    { "136 ", 4 }, { "137 ", 4 }, { "138 ", 4 }, { "139 ", 4 }, { "140 ", 4 }, { "141 ", 4 }, { "142 ", 4 }, { "143 ", 4 },
+    { "144 ", 4 }, { "145 ", 4 }, { "146 ", 4 }, { "147 ", 4 }, { "148 ", 4 }, { "149 ", 4 }, { "150 ", 4 }, { "151 ", 4 },
+    { "152 ", 4 }, { "153 ", 4 }, { "154 ", 4 }, { "155 ", 4 }, { "156 ", 4 }, { "157 ", 4 }, { "158 ", 4 }, { "159 ", 4 },
+    { "160 ", 4 }, { "161 ", 4 }, { "162 ", 4 }, { "163 ", 4 }, { "164 ", 4 }, { "165 ", 4 }, { "166 ", 4 }, { "167 ", 4 },
+    { "168 ", 4 }, { "169 ", 4 }, { "170 ", 4 }, { "171 ", 4 }, { "172 ", 4 }, { "173 ", 4 }, { "174 ", 4 }, { "175 ", 4 },
+    { "176 ", 4 }, { "177 ", 4 }, { "178 ", 4 }, { "179 ", 4 }, { "180 ", 4 }, { "181 ", 4 }, { "182 ", 4 }, { "183 ", 4 },
+    { "184 ", 4 }, { "185 ", 4 }, { "186 ", 4 }, { "187 ", 4 }, { "188 ", 4 }, { "189 ", 4 }, { "190 ", 4 }, { "191 ", 4 },
+    { "192 ", 4 }, { "193 ", 4 }, { "194 ", 4 }, { "195 ", 4 }, { "196 ", 4 }, { "197 ", 4 }, { "198 ", 4 }, { "199 ", 4 },
+    { "200 ", 4 }, { "201 ", 4 }, { "202 ", 4 }, { "203 ", 4 }, { "204 ", 4 }, { "205 ", 4 }, { "206 ", 4 }, { "207 ", 4 },
+    { "208 ", 4 }, { "209 ", 4 }, { "210 ", 4 }, { "211 ", 4 }, { "212 ", 4 }, { "213 ", 4 }, { "214 ", 4 }, { "215 ", 4 },
+    { "216 ", 4 }, { "217 ", 4 }, { "218 ", 4 }, { "219 ", 4 }, { "220 ", 4 }, { "221 ", 4 }, { "222 ", 4 }, { "223 ", 4 },
+    { "224 ", 4 }, { "225 ", 4 }, { "226 ", 4 }, { "227 ", 4 }, { "228 ", 4 }, { "229 ", 4 }, { "230 ", 4 }, { "231 ", 4 },
+    { "232 ", 4 }, { "233 ", 4 }, { "234 ", 4 }, { "235 ", 4 }, { "236 ", 4 }, { "237 ", 4 }, { "238 ", 4 }, { "239 ", 4 },
+    { "240 ", 4 }, { "241 ", 4 }, { "242 ", 4 }, { "243 ", 4 }, { "244 ", 4 }, { "245 ", 4 }, { "246 ", 4 }, { "247 ", 4 },
+    { "248 ", 4 }, { "249 ", 4 }, { "250 ", 4 }, { "251 ", 4 }, { "252 ", 4 }, { "253 ", 4 }, { "254 ", 4 }, { "255 ", 4 }
+};
+
+// Format `length` bytes as ASCII decimal values each followed by a space,
+// exactly as printf("%d ") per byte would. `text` must have room for
+// DEA_DECIMAL_MAX_CHARS * length characters (no terminator is written).
+// Returns the number of characters written.
+size_t dea_format_decimal(const uint8_t *data, size_t length, char *text) {
+    // Each 4-byte copy stays inside the worst-case buffer, since at most
+    // DEA_DECIMAL_MAX_CHARS characters were written per byte before it
+    char *out = text;
+    size_t i = 0;
+    for (; i + 4 <= length; i += 4) {
+        const DEA_DecimalEntry *e0 = &dea_decimal_table[data[i]];
+        const DEA_DecimalEntry *e1 = &dea_decimal_table[data[i + 1]];
+        const DEA_DecimalEntry *e2 = &dea_decimal_table[data[i + 2]];
+        const DEA_DecimalEntry *e3 = &dea_decimal_table[data[i + 3]];
+        memcpy(out, e0->text, 4);
+        out += e0->length;
+        memcpy(out, e1->text, 4);
+        out += e1->length;
+        memcpy(out, e2->text, 4);
+        out += e2->length;
+        memcpy(out, e3->text, 4);
+        out += e3->length;
+    }
+    for (; i < length; i++) {
+        const DEA_DecimalEntry *e = &dea_decimal_table[data[i]];
+        memcpy(out, e->text, 4);
+        out += e->length;
+    }
+    return (size_t)(out - text);
+}
+
+// Number of characters dea_format_decimal produces for `length` bytes,
+// without formatting them. Lets independent workers find where their part
+// of the text starts (an exclusive prefix sum of the lengths before it).
+size_t dea_decimal_length(const uint8_t *data, size_t length) {
+    size_t total = 2 * length;
+    for (size_t i = 0; i < length; i++) {
+        total += (data[i] >= 10) + (data[i] >= 100);
+    }
+    return total;
+}
+
+#if defined(_MSC_VER) && !defined(__clang__)
+static unsigned dea_ctz32(uint32_t x) {
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return (unsigned)index;
+}
+#else
+#define dea_ctz32(x) ((unsigned)__builtin_ctz(x))
+#endif
+
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_M_X64) || defined(_M_IX86)
+#define DEA_LITTLE_ENDIAN 1
+#else
+#define DEA_LITTLE_ENDIAN 0
+#endif
+
+static int dea_is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+#if DEA_X86
+// SSSE3 decoding of canonical "%d " text, after Muła and Langdale's
+// integer-list parsing: the space mask of a 12-character window indexes a
+// table of pshufb masks that move up to 4 values' digits into 4-byte
+// frames, right-aligned, and one multiply-add turns the frames into values.
+typedef struct {
+    uint8_t shuffle[16];
+    uint8_t count;              // Values decoded from this window (0 = use the scalar path)
+    uint8_t consumed;           // Characters they occupy, separators included
+} DEA_ParseEntry;
+
+static DEA_ParseEntry dea_parse_table[4096];
+// -1 unresolved, -2 table being built, 0 scalar, 1 SSSE3. The thread that
+// claims -2 builds the table and publishes it with a release store.
+static _Atomic int dea_parse_mode = -1;
+
+static void dea_parse_init_table(void) {
+    for (int mask = 0; mask < 4096; mask++) {
+        DEA_ParseEntry *entry = &dea_parse_table[mask];
+        memset(entry->shuffle, 0x80, sizeof(entry->shuffle));
+        int start = 0, count = 0;
+        for (int i = 0; i < 12 && count < 4; i++) {
+            if (!(mask >> i & 1)) {
+                continue;
+            }
+            int digits = i - start;
+            if (digits < 1 || digits > 3) {
+                break;          // Doubled separator or a 4+ digit run
+            }
+            for (int d = 0; d < digits; d++) {
+                entry->shuffle[4 * count + 3 - digits + d] = (uint8_t)(start + d);
+            }
+            count++;
+            start = i + 1;
+        }
+        entry->count = (uint8_t)count;
+        entry->consumed = (uint8_t)start;
+    }
+}
+
+// SSSE3 (CPUID leaf 1, ECX bit 9) unless DEA_KERNEL=scalar
+static int dea_parse_simd(void) {
+    int mode = atomic_load_explicit(&dea_parse_mode, memory_order_acquire);
+    if (mode >= 0) {
+        return mode;
+    }
+    int unresolved = -1;
+    if (!atomic_compare_exchange_strong(&dea_parse_mode, &unresolved, -2)) {
+        return 0;   // Another thread is building the table; use the scalar path meanwhile
+    }
+    unsigned regs[4];
+    dea_cpuid(1, 0, regs);
+    mode = (regs[2] & (1u << 9)) && strcmp(dea_get_kernel()->name, "scalar") != 0;
+    if (mode) {
+        dea_parse_init_table();
+    }
+    atomic_store_explicit(&dea_parse_mode, mode, memory_order_release);
+    return mode;
+}
+
+// Decode canonical windows from text[*pos] while 16 characters remain.
+// Stops at anything else (other whitespace, bad characters, values above
+// 255), which the scalar path then handles. Each step stores 4 bytes, up
+// to 3 past the values decoded. Returns the number of values decoded.
+DEA_TARGET("ssse3")
+static size_t dea_parse_decimal_ssse3(const char *text, size_t length, size_t *pos, uint8_t *data) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i weights = _mm_set1_epi32(0x00010A64);   // 100, 10, 1, 0 per frame
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i max_value = _mm_set1_epi32(255);
+    const __m128i gather = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    size_t p = *pos, count = 0;
+    while (p + 16 <= length) {
+        __m128i chars = _mm_loadu_si128((const __m128i*)(text + p));
+        unsigned spaces = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(chars, space));
+        __m128i digits = _mm_sub_epi8(chars, zero);
+        unsigned is_digit = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(digits, nine), digits));
+        const DEA_ParseEntry *entry = &dea_parse_table[spaces & 0xFFF];
+        unsigned window = (1u << entry->consumed) - 1;
+        if (entry->count == 0 || (~(is_digit | spaces) & window) != 0) {
+            break;
+        }
+        __m128i frames = _mm_shuffle_epi8(digits, _mm_loadu_si128((const __m128i*)entry->shuffle));
+        __m128i values = _mm_madd_epi16(_mm_maddubs_epi16(frames, weights), ones);
+        if (_mm_movemask_epi8(_mm_cmpgt_epi32(values, max_value)) != 0) {
+            break;
+        }
+        uint32_t packed = (uint32_t)_mm_cvtsi128_si32(_mm_shuffle_epi8(values, gather));
+        memcpy(data + count, &packed, 4);
+        count += entry->count;
+        p += entry->consumed;
+    }
+    *pos = p;
+    return count;
+}
+#endif
+
+// Parse ASCII decimal text ("%d " per byte, any whitespace between values)
+// back into bytes. Canonical text is decoded up to 4 values per SSSE3 step,
+// or without SSSE3 one value per 32-bit load: a SWAR test for which
+// characters are digits and a count-trailing-zeros to find the separator,
+// with no per-character branch. Unless `final`, a value running into the
+// end of `text` is left unparsed, so the text can be fed in chunks:
+// `*consumed` is where the next chunk has to start. `data` needs room for
+// length / 2 + 4 bytes. Returns
+// the number of bytes parsed, or (size_t)-1 on malformed text (a value
+// above 255 or a character that is neither a digit nor whitespace), with
+// `*consumed` set to its position.
+size_t dea_parse_decimal(const char *text, size_t length, int final, uint8_t *data, size_t *consumed) {
+    size_t pos = 0, count = 0;
+#if DEA_X86
+    int simd = dea_parse_simd();
+#endif
+    for (;;) {
+#if DEA_X86
+        if (simd) {
+            count += dea_parse_decimal_ssse3(text, length, &pos, data + count);
+        }
+#endif
+#if DEA_LITTLE_ENDIAN
+        // Fast path: a 1-3 digit value and its separator within 4 characters
+        while (pos + 4 <= length) {
+            uint32_t word;
+            memcpy(&word, text + pos, 4);
+            uint32_t digits = word - 0x30303030u;
+            // High nibble set in a byte: that character is not a digit. A
+            // borrow only disturbs bytes after the first non-digit.
+            uint32_t other = (digits | (digits + 0x06060606u)) & 0xF0F0F0F0u;
+            if (other == 0) {
+                break;          // 4 digits in a row: malformed, let the slow path report it
+            }
+            unsigned ndigits = dea_ctz32(other) >> 3;
+            if (ndigits == 0 || text[pos + ndigits] != ' ') {
+                break;          // Other whitespace or a bad character
+            }
+            // Right-align the digits in a 3-digit frame (missing leading
+            // digits become 0), so the value needs no branch on the count
+            uint32_t frame = (digits & ((1u << (ndigits * 8)) - 1)) << ((3 - ndigits) * 8);
+            unsigned value = (frame & 0xFF) * 100 + ((frame >> 8) & 0xFF) * 10 + ((frame >> 16) & 0xFF);
+            if (value > 255) {
+                break;
+            }
+            data[count++] = (uint8_t)value;
+            pos += ndigits + 1;
+        }
+#endif
+        // Slow path: skip whitespace, then one value a character at a time
+        while (pos < length && dea_is_space(text[pos])) {
+            pos++;
+        }
+        if (pos >= length) {
+            break;
+        }
+        size_t start = pos;
+        unsigned value = 0;
+        while (pos < length && text[pos] >= '0' && text[pos] <= '9' && value <= 255) {
+            value = value * 10 + (unsigned)(text[pos] - '0');
+            pos++;
+        }
+        if (pos == length && !final) {
+            pos = start;        // The value may continue in the next chunk
+            break;
+        }
+        if (pos == start || value > 255 || (pos < length && !dea_is_space(text[pos]))) {
+            *consumed = pos == start || value > 255 ? start : pos;
+            return (size_t)-1;
+        }
+        data[count++] = (uint8_t)value;
+    }
+    *consumed = pos;
+    return count;
+}
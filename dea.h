@@ -4,6 +4,25 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#if defined(__GNUC__) || defined(__clang__)
+#define DEA_ALIGNED(n) __attribute__((aligned(n)))
+#else
+#define DEA_ALIGNED(n) __declspec(align(n))
+#endif
+
+#define DEA_MAX_KEYS 4
+#define DEA_CACHE_LINE 64
+#define DEA_KEYSTREAM_BYTES 256   // One kernel stride (192 bytes) plus room to start at any phase
+
+// Store policies for dea_crypt_at_store
+#define DEA_STORE_AUTO 0          // Streaming at or above dea_streaming_threshold()
+#define DEA_STORE_CACHED 1        // Regular stores; output stays in cache
+#define DEA_STORE_STREAMING 2     // Non-temporal stores; output bypasses the cache
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 typedef struct {
     uint8_t keys[4];          // Storage for 4 8-bit keys
     uint8_t key_counter;      // Counter to cycle through keys (0-3)
@@ -12,7 +31,31 @@ typedef struct {
     int initialized;          // Flag to track initialization
 } DEA;
 
-// Core DEA functions
+// Immutable key schedule. The key sequence is expanded once into an aligned
+// keystream (4 cache lines), so a plan can be shared read-only by any
+// number of threads without copying or initialization checks.
+typedef struct {
+    DEA_ALIGNED(64) uint8_t keystream[DEA_KEYSTREAM_BYTES]; // keystream[i] = key for byte i
+    uint8_t keys[DEA_MAX_KEYS];   // Key registers the plan was built from
+    uint8_t num_keys;             // Number of keys (0-4)
+    uint8_t period;               // Key period in bytes (1 when no keys are set)
+} DEA_Plan;
+
+// Per-stream position in a plan's keystream
+typedef struct {
+    const DEA_Plan *plan;
+    uint64_t offset;              // Absolute stream offset of the next byte
+} DEA_Cursor;
+
+// Mergeable CRC32C digests of a stream range
+typedef struct {
+    uint32_t plain_crc;           // CRC32C of the plaintext
+    uint32_t cipher_crc;          // CRC32C of the ciphertext
+    uint64_t length;              // Bytes covered
+} DEA_Digest;
+
+// Core DEA functions. Block functions accept output == data (in place);
+// other overlapping buffers are not supported.
 void dea_init(DEA *dea);
 void dea_reset(DEA *dea);
 void dea_set_key(DEA *dea, uint8_t key);
@@ -20,4 +63,200 @@ uint8_t dea_encrypt_byte(DEA *dea, uint8_t data_in);
 void dea_encrypt_block(DEA *dea, uint8_t *data, size_t length, uint8_t *output);
 void dea_decrypt_block(DEA *dea, uint8_t *data, size_t length, uint8_t *output);
 
+// Key-schedule plans and cursors
+int dea_plan_init(DEA_Plan *plan, const uint8_t *keys, int num_keys);
+DEA_Plan *dea_plan_create(const uint8_t *keys, int num_keys);
+void dea_plan_destroy(DEA_Plan *plan);
+uint64_t dea_plan_fingerprint(const DEA_Plan *plan);
+void dea_crypt_at(const DEA_Plan *plan, uint64_t offset, const uint8_t *data, size_t length, uint8_t *output);
+void dea_crypt_at_store(const DEA_Plan *plan, uint64_t offset, const uint8_t *data, size_t length,
+                        uint8_t *output, int store_mode);
+size_t dea_streaming_threshold(void);
+size_t dea_encrypt_verified(const DEA_Plan *plan, uint64_t offset, const uint8_t *data, size_t length, uint8_t *output);
+size_t dea_encrypt_digest(const DEA_Plan *plan, uint64_t offset, const uint8_t *data, size_t length,
+                          uint8_t *output, DEA_Digest *digest);
+void dea_cursor_init(DEA_Cursor *cursor, const DEA_Plan *plan, uint64_t offset);
+void dea_cursor_crypt(DEA_Cursor *cursor, const uint8_t *data, size_t length, uint8_t *output);
+
+// CRC32C integrity digests
+uint32_t dea_crc32c(uint32_t crc, const uint8_t *data, size_t length);
+uint32_t dea_crc32c_combine(uint32_t crc_a, uint32_t crc_b, uint64_t length_b);
+void dea_digest_init(DEA_Digest *digest);
+void dea_digest_merge(DEA_Digest *digest, const DEA_Digest *next);
+
+// ASCII decimal format of the ciphertext files: every byte as "%d ". A
+// formatted byte is at most DEA_DECIMAL_MAX_CHARS characters ("255 ").
+#define DEA_DECIMAL_MAX_CHARS 4
+size_t dea_format_decimal(const uint8_t *data, size_t length, char *text);
+size_t dea_decimal_length(const uint8_t *data, size_t length);
+size_t dea_parse_decimal(const char *text, size_t length, int final, uint8_t *data, size_t *consumed);
+
+// Work partitioning shared by the thread pool and MPI
+size_t dea_partition_quantum(int num_keys, size_t align);
+int dea_partition(size_t n_bytes, int n_workers, int num_keys, size_t align, size_t *bounds);
+int dea_partition_weighted(size_t n_bytes, int n_workers, int num_keys, size_t align,
+                           const double *weights, size_t *bounds);
+
+// Persistent thread pool and multi-threaded encryption (dea_pool.c)
+typedef struct DEA_Pool DEA_Pool;
+typedef void (*dea_task_fn)(void *arg, int worker, int num_workers);
+
+int dea_default_threads(void);
+DEA_Pool *dea_pool_create(int num_threads);
+void dea_pool_destroy(DEA_Pool *pool);
+int dea_pool_threads(const DEA_Pool *pool);
+void dea_pool_run(DEA_Pool *pool, dea_task_fn fn, void *arg);
+void dea_encrypt_parallel(DEA_Pool *pool, const DEA_Plan *plan, uint64_t offset,
+                          const uint8_t *data, size_t length, uint8_t *output);
+size_t dea_encrypt_verified_parallel(DEA_Pool *pool, const DEA_Plan *plan, uint64_t offset,
+                                     const uint8_t *data, size_t length, uint8_t *output);
+size_t dea_encrypt_digest_parallel(DEA_Pool *pool, const DEA_Plan *plan, uint64_t offset,
+                                   const uint8_t *data, size_t length, uint8_t *output, DEA_Digest *digest);
+
+// File I/O (dea_io.c): memory mapping, double-buffered streaming and
+// parallel text output
+typedef struct {
+    uint8_t *data;                // Mapped bytes (NULL for an empty file)
+    size_t size;
+    int writable;
+    int fd;                       // POSIX file descriptor (-1 if none)
+    void *handle;                 // Windows file handle
+} DEA_Mapping;
+
+int dea_map_input(const char *path, DEA_Mapping *map);
+int dea_map_output(const char *path, size_t size, DEA_Mapping *map);
+void dea_unmap(DEA_Mapping *map);
+
+// Double-buffered sequential window reader
+typedef struct DEA_Stream DEA_Stream;
+
+DEA_Stream *dea_stream_open(const char *path, size_t window);
+size_t dea_stream_next(DEA_Stream *stream, uint8_t **data, uint64_t *offset);
+int dea_stream_error(const DEA_Stream *stream);
+void dea_stream_close(DEA_Stream *stream);
+
+// Parallel ASCII decimal output: every worker formats its own slice and
+// writes it at the offset given by the text lengths of the slices before it
+int dea_write_decimal(DEA_Pool *pool, const char *path, const uint8_t *data, size_t length);
+
+// Reader -> encryption workers -> ordered writer pipeline (dea_pipeline.c)
+#define DEA_PIPE_CRYPT 0          // Encrypt only
+#define DEA_PIPE_VERIFY 1         // Encrypt with the fused round-trip check
+#define DEA_PIPE_DIGEST 2         // Encrypt, check and digest (DEA_PipelineStats.digest)
+
+typedef struct {
+    size_t block_size;            // Bytes per block (0 = 4 MB)
+    int blocks;                   // Blocks in the pool (0 = 2 * workers + 2)
+    int workers;                  // Encryption threads (0 = dea_default_threads())
+    int mode;                     // DEA_PIPE_CRYPT, DEA_PIPE_VERIFY or DEA_PIPE_DIGEST
+} DEA_PipelineConfig;
+
+typedef struct {
+    uint64_t bytes;               // Bytes written
+    double seconds;               // Wall time of the run
+    double read_busy;             // Fraction of the run the reader spent in `read`
+    double encrypt_busy;          // Average fraction each worker spent encrypting
+    double write_busy;            // Fraction of the run the writer spent in `write`
+    int workers;
+    uint64_t mismatch;            // First round-trip mismatch offset, or UINT64_MAX
+    DEA_Digest digest;            // Whole-stream digest (DEA_PIPE_DIGEST)
+} DEA_PipelineStats;
+
+typedef size_t (*dea_read_fn)(void *ctx, uint8_t *buffer, size_t capacity);
+typedef int (*dea_write_fn)(void *ctx, uint8_t *data, size_t length, uint64_t offset);
+
+int dea_pipeline_run(const DEA_Plan *plan, const DEA_PipelineConfig *config,
+                     dea_read_fn read, void *read_ctx, dea_write_fn write, void *write_ctx,
+                     DEA_PipelineStats *stats);
+
+// Asynchronous file-to-file encryption (dea_aio.c): io_uring with
+// registered buffers and files, or synchronous pread/pwrite
+#define DEA_AIO_AUTO 0            // io_uring if the kernel allows it, else pread/pwrite
+#define DEA_AIO_URING 1
+#define DEA_AIO_PREAD 2
+
+typedef struct {
+    size_t block_size;            // Bytes per request (0 = 1 MB)
+    int depth;                    // Blocks in flight (0 = 16)
+    int backend;                  // DEA_AIO_AUTO, DEA_AIO_URING or DEA_AIO_PREAD
+    int mode;                     // DEA_PIPE_CRYPT, DEA_PIPE_VERIFY or DEA_PIPE_DIGEST
+    int direct;                   // Bypass the page cache (O_DIRECT, else posix_fadvise DONTNEED)
+} DEA_AioConfig;
+
+typedef struct {
+    uint64_t bytes;               // Bytes written
+    double seconds;               // Wall time of the run
+    int backend;                  // Backend actually used
+    int direct;                   // Both files were opened with O_DIRECT
+    uint64_t mismatch;            // First round-trip mismatch offset, or UINT64_MAX
+    DEA_Digest digest;            // Whole-file digest (DEA_PIPE_DIGEST)
+} DEA_AioStats;
+
+int dea_aio_crypt_file(const DEA_Plan *plan, const char *input_path, const char *output_path,
+                       const DEA_AioConfig *config, DEA_AioStats *stats);
+const char *dea_aio_backend_name(int backend);
+
+// Indexed binary container and random-access reader (dea_container.c).
+// Container layout, little-endian:
+//   header   DEA_CONTAINER_HEADER bytes: magic, version, key count, key-set
+//            fingerprint, chunk size, plaintext length
+//   data     the ciphertext, one chunk after another
+//   index    one entry per chunk: file offset, length, plaintext and
+//            ciphertext CRC32C
+//   trailer  DEA_CONTAINER_TRAILER bytes: index offset, chunk count, index
+//            CRC32C, magic
+// Byte i of the plaintext is in chunk i / chunk_size, so any range can be
+// located, decrypted (the key phase follows from the offset) and checked
+// without touching the rest of the file.
+#define DEA_CONTAINER_HEADER 64
+#define DEA_CONTAINER_ENTRY 24
+#define DEA_CONTAINER_TRAILER 32
+#define DEA_CONTAINER_CHUNK (1024 * 1024)   // Default chunk size
+
+typedef struct {
+    uint64_t offset;              // File offset of the chunk's ciphertext
+    uint64_t length;              // Bytes in the chunk
+    uint32_t plain_crc;           // CRC32C of the chunk's plaintext
+    uint32_t cipher_crc;          // CRC32C of the chunk's ciphertext
+} DEA_ChunkEntry;
+
+typedef struct {
+    uint64_t fingerprint;         // dea_plan_fingerprint of the key set
+    int num_keys;
+    uint64_t chunk_size;          // Plaintext bytes per chunk (the last may be shorter)
+    uint64_t length;              // Plaintext bytes in the file
+    uint64_t num_chunks;
+    DEA_ChunkEntry *index;        // One entry per chunk, in stream order
+    int fd;                       // POSIX file descriptor (-1 if none)
+    void *handle;                 // Windows file handle
+} DEA_Container;
+
+int dea_container_write(DEA_Pool *pool, const DEA_Plan *plan, const char *path, const uint8_t *data,
+                        size_t length, size_t chunk_size, DEA_Digest *digest);
+int dea_container_probe(const char *path);
+int dea_container_open(const char *path, const DEA_Plan *plan, DEA_Container *container);
+int dea_container_read(const DEA_Container *container, const DEA_Plan *plan, uint64_t offset,
+                       size_t length, uint8_t *output);
+int dea_container_decrypt(DEA_Pool *pool, const DEA_Container *container, const DEA_Plan *plan,
+                          uint8_t *output, uint64_t *bad_chunk);
+void dea_container_close(DEA_Container *container);
+
+// Random-access decrypting reader with an LRU cache of decrypted pages,
+// over a container or a raw binary ciphertext file
+typedef struct DEA_Reader DEA_Reader;
+
+DEA_Reader *dea_reader_open(const char *path, const DEA_Plan *plan, size_t page_size, int cache_pages);
+uint64_t dea_reader_size(const DEA_Reader *reader);
+size_t dea_reader_pread(DEA_Reader *reader, void *buffer, size_t length, uint64_t offset);
+int dea_reader_error(const DEA_Reader *reader);
+void dea_reader_stats(const DEA_Reader *reader, uint64_t *hits, uint64_t *misses);
+void dea_reader_close(DEA_Reader *reader);
+
+// Name of the SIMD kernel picked at runtime ("scalar", "sse2", "avx2", "avx512")
+const char *dea_kernel_name(void);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif // DEA_H
\ No newline at end of file
@@ -0,0 +1,174 @@
+#ifndef DEA_HPP
+#define DEA_HPP
+
+// Header-only C++20 layer over dea.h. dea::Cipher<N> is specialized on the
+// key count, so the key period is a compile-time constant: short buffers go
+// through a fully unrolled kernel with no per-byte modulo, long ones through
+// the runtime-dispatched SIMD kernels of dea.c. The choice is made once per
+// call. The C library (dea.c, dea_pool.c) is compiled as C and linked in.
+
+#include "dea.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <execution>
+#include <functional>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dea {
+
+// Name of the SIMD kernel dea.c picked for this CPU
+inline const char *kernel_name() {
+    return dea_kernel_name();
+}
+
+template <int N>
+class Cipher {
+    static_assert(N >= 0 && N <= DEA_MAX_KEYS, "DEA supports 0 to 4 keys");
+
+public:
+    static constexpr int num_keys = N;
+    static constexpr std::size_t period = N == 0 ? 1 : N;
+
+    // Bytes per unrolled step: the smallest multiple of the key period that
+    // is a whole number of 64-bit words
+    static constexpr std::size_t block_bytes = std::lcm(period, std::size_t{8});
+    static constexpr std::size_t block_words = block_bytes / 8;
+
+    // Below this many bytes the unrolled kernel beats the SIMD path's setup
+    static constexpr std::size_t small_bytes = 1024;
+
+    // Bytes per task for the parallel overloads; a multiple of the key period
+    // and of the cache line, so every task starts at the same key phase and
+    // tasks never share a cache line of output
+    static constexpr std::size_t task_bytes = std::lcm(period, std::size_t{DEA_CACHE_LINE}) * 4096;
+
+    Cipher() requires (N == 0) {
+        dea_plan_init(&plan_, nullptr, 0);
+    }
+
+    explicit Cipher(const std::array<std::uint8_t, N> &keys) requires (N > 0) {
+        dea_plan_init(&plan_, keys.data(), N);
+    }
+
+    // Encrypt or decrypt (the same XOR) `in` into `out` at absolute stream
+    // `offset`. `out` must be at least as long as `in` and may be the same
+    // memory; other overlaps are not supported.
+    void crypt(std::span<const std::uint8_t> in, std::span<std::uint8_t> out, std::uint64_t offset = 0) const {
+        check_sizes(in, out);
+        crypt_range(offset, in.data(), in.size(), out.data());
+    }
+
+    // Encrypt in place
+    void crypt(std::span<std::uint8_t> data, std::uint64_t offset = 0) const {
+        crypt_range(offset, data.data(), data.size(), data.data());
+    }
+
+    // Encrypt and verify the round trip in the same pass (dea_encrypt_verified).
+    // Returns the index of the first byte that does not round-trip, or in.size().
+    std::size_t crypt_verified(std::span<const std::uint8_t> in, std::span<std::uint8_t> out,
+                               std::uint64_t offset = 0) const {
+        check_sizes(in, out);
+        return dea_encrypt_verified(&plan_, offset, in.data(), in.size(), out.data());
+    }
+
+    // Parallel overloads taking a standard execution policy, e.g.
+    // std::execution::par_unseq. The buffer is cut into task_bytes pieces,
+    // each encrypted at its own stream offset.
+    template <class Policy>
+        requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+    void crypt(Policy &&policy, std::span<const std::uint8_t> in, std::span<std::uint8_t> out,
+               std::uint64_t offset = 0) const {
+        check_sizes(in, out);
+        const std::vector<std::size_t> tasks = task_starts(in.size());
+        std::for_each(std::forward<Policy>(policy), tasks.begin(), tasks.end(), [&](std::size_t begin) {
+            std::size_t length = std::min(task_bytes, in.size() - begin);
+            dea_crypt_at(&plan_, offset + begin, in.data() + begin, length, out.data() + begin);
+        });
+    }
+
+    template <class Policy>
+        requires std::is_execution_policy_v<std::remove_cvref_t<Policy>>
+    std::size_t crypt_verified(Policy &&policy, std::span<const std::uint8_t> in, std::span<std::uint8_t> out,
+                               std::uint64_t offset = 0) const {
+        check_sizes(in, out);
+        const std::vector<std::size_t> tasks = task_starts(in.size());
+        const std::size_t total = in.size();
+        return std::transform_reduce(std::forward<Policy>(policy), tasks.begin(), tasks.end(), total,
+            [](std::size_t a, std::size_t b) { return std::min(a, b); },
+            [&](std::size_t begin) {
+                std::size_t length = std::min(task_bytes, total - begin);
+                std::size_t bad = dea_encrypt_verified(&plan_, offset + begin, in.data() + begin,
+                                                       length, out.data() + begin);
+                return bad == length ? total : begin + bad;
+            });
+    }
+
+    // The underlying C plan, for calls into the rest of dea.h
+    const DEA_Plan &plan() const {
+        return plan_;
+    }
+
+private:
+    DEA_Plan plan_;
+
+    static void check_sizes(std::span<const std::uint8_t> in, std::span<std::uint8_t> out) {
+        if (out.size() < in.size()) {
+            throw std::length_error("dea::Cipher: output span is shorter than input");
+        }
+    }
+
+    static std::vector<std::size_t> task_starts(std::size_t length) {
+        std::vector<std::size_t> starts((length + task_bytes - 1) / task_bytes);
+        for (std::size_t t = 0; t < starts.size(); t++) {
+            starts[t] = t * task_bytes;
+        }
+        return starts;
+    }
+
+    void crypt_range(std::uint64_t offset, const std::uint8_t *in, std::size_t length, std::uint8_t *out) const {
+        if (length < small_bytes) {
+            crypt_unrolled(offset, in, length, out);
+        } else {
+            dea_crypt_at(&plan_, offset, in, length, out);
+        }
+    }
+
+    // One block_bytes step per iteration, its block_words 64-bit XORs
+    // unrolled at compile time. The keystream holds DEA_STRIDE bytes from
+    // any phase, which covers block_bytes.
+    void crypt_unrolled(std::uint64_t offset, const std::uint8_t *in, std::size_t length, std::uint8_t *out) const {
+        const std::uint8_t *ks = plan_.keystream + offset % period;
+        std::array<std::uint64_t, block_words> key;
+        std::memcpy(key.data(), ks, block_bytes);
+
+        std::size_t i = 0;
+        for (; i + block_bytes <= length; i += block_bytes) {
+            [&]<std::size_t... W>(std::index_sequence<W...>) {
+                ((xor_word(in + i + 8 * W, out + i + 8 * W, key[W])), ...);
+            }(std::make_index_sequence<block_words>{});
+        }
+        for (std::size_t k = 0; i < length; i++, k++) {
+            out[i] = in[i] ^ ks[k];
+        }
+    }
+
+    static void xor_word(const std::uint8_t *in, std::uint8_t *out, std::uint64_t key) {
+        std::uint64_t word;
+        std::memcpy(&word, in, 8);
+        word ^= key;
+        std::memcpy(out, &word, 8);
+    }
+};
+
+} // namespace dea
+
+#endif // DEA_HPP
@@ -0,0 +1,617 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE   // pread/pwrite, syscall
+#endif
+#include "dea.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define DEA_HAVE_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+#endif
+
+#define DEA_AIO_BLOCK_BYTES (1024 * 1024)
+#define DEA_AIO_DEPTH 16
+// Buffer, offset and length alignment: pages pin cleanly when registered,
+// and O_DIRECT needs at least the device's logical block size (512 or 4096)
+#define DEA_AIO_ALIGN 4096
+
+const char *dea_aio_backend_name(int backend) {
+    switch (backend) {
+    case DEA_AIO_URING: return "io_uring";
+    case DEA_AIO_PREAD: return "pread/pwrite";
+    default: return "auto";
+    }
+}
+
+static double dea_aio_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint8_t *dea_aio_alloc(size_t size) {
+#ifdef _WIN32
+    return (uint8_t*)_aligned_malloc(size, DEA_AIO_ALIGN);
+#else
+    void *buffer = NULL;
+    return posix_memalign(&buffer, DEA_AIO_ALIGN, size) == 0 ? (uint8_t*)buffer : NULL;
+#endif
+}
+
+static void dea_aio_free(uint8_t *buffer) {
+#ifdef _WIN32
+    _aligned_free(buffer);
+#else
+    free(buffer);
+#endif
+}
+
+// Encrypt one block in place at its stream offset, in stream order, so the
+// digest extends directly and the first mismatch is the first one reported
+static void dea_aio_crypt_block(const DEA_Plan *plan, int mode, uint64_t offset,
+                                uint8_t *data, size_t length, DEA_AioStats *stats) {
+    size_t bad = length;
+    if (mode == DEA_PIPE_DIGEST) {
+        bad = dea_encrypt_digest(plan, offset, data, length, data, &stats->digest);
+    } else if (mode == DEA_PIPE_VERIFY) {
+        bad = dea_encrypt_verified(plan, offset, data, length, data);
+    } else {
+        dea_crypt_at(plan, offset, data, length, data);
+    }
+    if (bad != length && stats->mismatch == UINT64_MAX) {
+        stats->mismatch = offset + bad;
+    }
+}
+
+// Transfer size for a block of `length` bytes: O_DIRECT moves whole
+// aligned units
+static size_t dea_aio_round_up(size_t length, int direct) {
+    return direct ? (length + DEA_AIO_ALIGN - 1) & ~(size_t)(DEA_AIO_ALIGN - 1) : length;
+}
+
+#ifdef _WIN32
+
+// No pread/pwrite (and no O_DIRECT: `direct` is ignored): one block at a time through stdio
+static int dea_aio_run_sync(const DEA_Plan *plan, const char *input_path, const char *output_path,
+                            const DEA_AioConfig *cfg, uint8_t *buffer, DEA_AioStats *stats) {
+    FILE *in = fopen(input_path, "rb");
+    FILE *out = in ? fopen(output_path, "wb") : NULL;
+    if (!in || !out) {
+        if (in) fclose(in);
+        return 0;
+    }
+    int ok = 1;
+    size_t length;
+    while ((length = fread(buffer, 1, cfg->block_size, in)) > 0) {
+        dea_aio_crypt_block(plan, cfg->mode, stats->bytes, buffer, length, stats);
+        if (fwrite(buffer, 1, length, out) != length) {
+            ok = 0;
+            break;
+        }
+        stats->bytes += length;
+    }
+    if (ferror(in)) ok = 0;
+    fclose(in);
+    if (fclose(out) != 0) ok = 0;
+    return ok;
+}
+
+#else
+
+// Open files of one run. With O_DIRECT every transfer must be a multiple
+// of DEA_AIO_ALIGN, so the final block is read and written rounded up: the
+// read stops at end of file, the zero padding is written and the output is
+// truncated to size afterwards. A file that cannot be opened O_DIRECT
+// (tmpfs, some network filesystems) goes through the page cache instead,
+// and with `direct` its pages are dropped as each block is done.
+typedef struct {
+    int in_fd, out_fd;
+    int in_direct, out_direct;
+    int drop_cache;
+    uint64_t size;
+} DEA_AioFiles;
+
+// Drop a finished range from the page cache. Dirty pages are written back
+// first, since DONTNEED only drops clean ones.
+static void dea_aio_drop_cache(int fd, uint64_t offset, size_t length, int written) {
+#ifdef __linux__
+    if (written) {
+        sync_file_range(fd, (off_t)offset, (off_t)length,
+                        SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+    }
+#else
+    if (written) {
+        fdatasync(fd);
+    }
+#endif
+    posix_fadvise(fd, (off_t)offset, (off_t)length, POSIX_FADV_DONTNEED);
+}
+
+static int dea_aio_open_files(const char *input_path, const char *output_path, int direct, DEA_AioFiles *files) {
+    memset(files, 0, sizeof(*files));
+    files->in_fd = files->out_fd = -1;
+#ifdef O_DIRECT
+    if (direct) {
+        files->in_fd = open(input_path, O_RDONLY | O_DIRECT);
+        files->out_fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+        files->in_direct = files->in_fd >= 0;
+        files->out_direct = files->out_fd >= 0;
+    }
+#endif
+    if (files->in_fd < 0) {
+        files->in_fd = open(input_path, O_RDONLY);
+    }
+    if (files->out_fd < 0 && files->in_fd >= 0) {
+        files->out_fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    files->drop_cache = direct && !(files->in_direct && files->out_direct);
+    struct stat st;
+    if (files->in_fd < 0 || files->out_fd < 0 || fstat(files->in_fd, &st) != 0) {
+        return 0;
+    }
+    files->size = (uint64_t)st.st_size;
+    if (!files->in_direct && direct) {
+        posix_fadvise(files->in_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    // Size the output up front so writes never extend the file
+    return ftruncate(files->out_fd, (off_t)files->size) == 0;
+}
+
+// Read `length` bytes, asking for `request` (>= length, aligned for
+// O_DIRECT); the final block's read comes back short at end of file
+static int dea_aio_pread_full(int fd, uint8_t *buffer, size_t length, size_t request, uint64_t offset) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = pread(fd, buffer + done, request - done, (off_t)(offset + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        done += (size_t)n;
+    }
+    return 1;
+}
+
+static int dea_aio_pwrite_full(int fd, const uint8_t *buffer, size_t length, uint64_t offset) {
+    while (length > 0) {
+        ssize_t n = pwrite(fd, buffer, length, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        buffer += n;
+        length -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return 1;
+}
+
+// Synchronous fallback: read, encrypt and write one block at a time
+static int dea_aio_run_pread(const DEA_Plan *plan, const DEA_AioFiles *files,
+                             const DEA_AioConfig *cfg, uint8_t *buffer, DEA_AioStats *stats) {
+    uint64_t size = files->size;
+    for (uint64_t offset = 0; offset < size; offset += cfg->block_size) {
+        size_t length = (size_t)(size - offset < cfg->block_size ? size - offset : cfg->block_size);
+        size_t in_length = dea_aio_round_up(length, files->in_direct);
+        size_t out_length = dea_aio_round_up(length, files->out_direct);
+        if (!dea_aio_pread_full(files->in_fd, buffer, length, in_length, offset)) {
+            return 0;
+        }
+        dea_aio_crypt_block(plan, cfg->mode, offset, buffer, length, stats);
+        memset(buffer + length, 0, out_length - length);
+        if (!dea_aio_pwrite_full(files->out_fd, buffer, out_length, offset)) {
+            return 0;
+        }
+        if (files->drop_cache) {
+            if (!files->in_direct) dea_aio_drop_cache(files->in_fd, offset, length, 0);
+            if (!files->out_direct) dea_aio_drop_cache(files->out_fd, offset, length, 1);
+        }
+        stats->bytes += length;
+    }
+    return 1;
+}
+
+#endif
+
+#ifdef DEA_HAVE_URING
+
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#define __NR_io_uring_enter 426
+#define __NR_io_uring_register 427
+#endif
+
+// Minimal io_uring over the raw syscalls (no liburing): one submission and
+// one completion ring shared with the kernel
+typedef struct {
+    int fd;
+    void *sq_map, *cq_map;
+    size_t sq_map_size, cq_map_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned to_submit;
+} DEA_Uring;
+
+static void dea_uring_close(DEA_Uring *ring) {
+    if (ring->sqes) munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_map && ring->cq_map != ring->sq_map) munmap(ring->cq_map, ring->cq_map_size);
+    if (ring->sq_map) munmap(ring->sq_map, ring->sq_map_size);
+    if (ring->fd >= 0) close(ring->fd);
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+static int dea_uring_open(DEA_Uring *ring, unsigned entries) {
+    memset(ring, 0, sizeof(*ring));
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        ring->fd = -1;
+        return 0;   // Old kernel, or disabled by seccomp / io_uring_disabled
+    }
+
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_map_size > ring->sq_map_size) ring->sq_map_size = ring->cq_map_size;
+        ring->cq_map_size = ring->sq_map_size;
+    }
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_map == MAP_FAILED) {
+        ring->sq_map = NULL;
+        dea_uring_close(ring);
+        return 0;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_map = ring->sq_map;
+    } else {
+        ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_map == MAP_FAILED) {
+            ring->cq_map = NULL;
+            dea_uring_close(ring);
+            return 0;
+        }
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                                            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        dea_uring_close(ring);
+        return 0;
+    }
+
+    uint8_t *sq = (uint8_t*)ring->sq_map;
+    uint8_t *cq = (uint8_t*)ring->cq_map;
+    ring->sq_head = (unsigned*)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    return 1;
+}
+
+// Queue one read or write; it is handed to the kernel by dea_uring_enter.
+// The ring has an entry for every block, so it never fills.
+static void dea_uring_queue(DEA_Uring *ring, int opcode, int fd, int fixed_file, int buf_index,
+                            uint8_t *buffer, unsigned length, uint64_t offset, uint64_t user_data) {
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = (uint8_t)opcode;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = (uint64_t)(uintptr_t)buffer;
+    sqe->len = length;
+    sqe->user_data = user_data;
+    if (fixed_file) {
+        sqe->flags |= IOSQE_FIXED_FILE;
+    }
+    if (buf_index >= 0) {
+        sqe->buf_index = (uint16_t)buf_index;
+    }
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->to_submit++;
+}
+
+// Submit the queued requests and wait for at least `wait` completions
+static int dea_uring_enter(DEA_Uring *ring, unsigned wait) {
+    for (;;) {
+        long submitted = syscall(__NR_io_uring_enter, ring->fd, ring->to_submit, wait,
+                                 wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (submitted >= 0) {
+            ring->to_submit -= (unsigned)submitted;
+            return 1;
+        }
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            return 0;
+        }
+    }
+}
+
+enum { DEA_SLOT_FREE, DEA_SLOT_READING, DEA_SLOT_READ, DEA_SLOT_WRITING };
+
+typedef struct {
+    int state;
+    uint64_t seq;               // Block number in the file
+    uint64_t offset;
+    size_t length;
+    size_t transfer;            // Bytes to read or write: length, rounded up for O_DIRECT
+    size_t done;                // Bytes of the current read or write completed so far
+} DEA_AioSlot;
+
+typedef struct {
+    DEA_Uring ring;
+    const DEA_AioConfig *cfg;
+    uint8_t *arena;
+    DEA_AioSlot *slots;
+    struct iovec *vecs;         // Per-slot iovec when the buffers are not registered
+    const DEA_AioFiles *files;
+    int fixed_buffers, fixed_files;
+    int in_fd, out_fd;          // Registered file indices, or the descriptors
+    unsigned in_flight;
+} DEA_AioRun;
+
+// Queue the outstanding part of a slot's read or write
+static void dea_aio_submit(DEA_AioRun *run, int index, int is_write) {
+    DEA_AioSlot *slot = &run->slots[index];
+    uint8_t *buffer = run->arena + (size_t)index * run->cfg->block_size + slot->done;
+    unsigned length = (unsigned)(slot->transfer - slot->done);
+    int fd = is_write ? run->out_fd : run->in_fd;
+    if (run->fixed_buffers) {
+        dea_uring_queue(&run->ring, is_write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED, fd,
+                        run->fixed_files, index, buffer, length, slot->offset + slot->done, (uint64_t)index);
+    } else {
+        run->vecs[index].iov_base = buffer;
+        run->vecs[index].iov_len = length;
+        dea_uring_queue(&run->ring, is_write ? IORING_OP_WRITEV : IORING_OP_READV, fd,
+                        run->fixed_files, -1, (uint8_t*)&run->vecs[index], 1,
+                        slot->offset + slot->done, (uint64_t)index);
+    }
+    run->in_flight++;
+}
+
+static void dea_aio_start_read(DEA_AioRun *run, int index, uint64_t seq) {
+    DEA_AioSlot *slot = &run->slots[index];
+    uint64_t block = run->cfg->block_size;
+    uint64_t size = run->files->size;
+    slot->state = DEA_SLOT_READING;
+    slot->seq = seq;
+    slot->offset = seq * block;
+    slot->length = (size_t)(size - slot->offset < block ? size - slot->offset : block);
+    slot->transfer = dea_aio_round_up(slot->length, run->files->in_direct);
+    slot->done = 0;
+    dea_aio_submit(run, index, 0);
+}
+
+// One thread keeps `depth` reads and writes in flight. Each slot owns one
+// registered buffer: it is read, encrypted in place once every earlier
+// block has been (so the digest extends in order), written, and reused for
+// the next unread block. Requests use the fixed buffers and files, so the
+// kernel skips page pinning and fd lookup on every I/O. Returns 0 on an I/O
+// error, -1 if io_uring cannot be set up (nothing has been read yet).
+static int dea_aio_run_uring(const DEA_Plan *plan, const DEA_AioFiles *files,
+                             const DEA_AioConfig *cfg, uint8_t *arena, DEA_AioStats *stats) {
+    DEA_AioRun run;
+    memset(&run, 0, sizeof(run));
+    run.cfg = cfg;
+    run.files = files;
+    run.arena = arena;
+    if (!dea_uring_open(&run.ring, (unsigned)cfg->depth)) {
+        return -1;
+    }
+    run.slots = (DEA_AioSlot*)calloc((size_t)cfg->depth, sizeof(DEA_AioSlot));
+    run.vecs = (struct iovec*)calloc((size_t)cfg->depth, sizeof(struct iovec));
+    if (!run.slots || !run.vecs) {
+        free(run.slots);
+        free(run.vecs);
+        dea_uring_close(&run.ring);
+        return -1;
+    }
+
+    // Registration needs locked-memory quota; without it plain readv/writev still work
+    for (int i = 0; i < cfg->depth; i++) {
+        run.vecs[i].iov_base = arena + (size_t)i * cfg->block_size;
+        run.vecs[i].iov_len = cfg->block_size;
+    }
+    run.fixed_buffers = syscall(__NR_io_uring_register, run.ring.fd, IORING_REGISTER_BUFFERS,
+                                run.vecs, (unsigned)cfg->depth) == 0;
+    int fds[2] = { files->in_fd, files->out_fd };
+    run.fixed_files = syscall(__NR_io_uring_register, run.ring.fd, IORING_REGISTER_FILES, fds, 2) == 0;
+    run.in_fd = run.fixed_files ? 0 : files->in_fd;
+    run.out_fd = run.fixed_files ? 1 : files->out_fd;
+
+    uint64_t total_blocks = (files->size + cfg->block_size - 1) / cfg->block_size;
+    uint64_t next_read = 0, next_crypt = 0, written = 0;
+    int ok = 1;
+
+    for (int i = 0; i < cfg->depth && next_read < total_blocks; i++) {
+        dea_aio_start_read(&run, i, next_read++);
+    }
+
+    while (written < total_blocks) {
+        if (!dea_uring_enter(&run.ring, run.in_flight > 0 ? 1 : 0)) {
+            ok = 0;
+            break;
+        }
+
+        // Reap completions
+        unsigned head = *run.ring.cq_head;
+        unsigned tail = __atomic_load_n(run.ring.cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            struct io_uring_cqe *cqe = &run.ring.cqes[head & *run.ring.cq_mask];
+            int index = (int)cqe->user_data;
+            DEA_AioSlot *slot = &run.slots[index];
+            run.in_flight--;
+            if (cqe->res <= 0) {
+                ok = 0;   // I/O error, or the input shrank under us
+                continue;
+            }
+            slot->done += (size_t)cqe->res;
+            if (slot->done < (slot->state == DEA_SLOT_WRITING ? slot->transfer : slot->length)) {
+                // Short read or write: queue the rest
+                dea_aio_submit(&run, index, slot->state == DEA_SLOT_WRITING);
+            } else if (slot->state == DEA_SLOT_READING) {
+                slot->state = DEA_SLOT_READ;
+                if (files->drop_cache && !files->in_direct) {
+                    dea_aio_drop_cache(files->in_fd, slot->offset, slot->length, 0);
+                }
+            } else {
+                if (files->drop_cache && !files->out_direct) {
+                    dea_aio_drop_cache(files->out_fd, slot->offset, slot->length, 1);
+                }
+                stats->bytes += slot->length;
+                written++;
+                slot->state = DEA_SLOT_FREE;
+            }
+        }
+        __atomic_store_n(run.ring.cq_head, head, __ATOMIC_RELEASE);
+        if (!ok) {
+            break;
+        }
+
+        // Encrypt whatever is next in file order, then start its write
+        for (int progress = 1; progress;) {
+            progress = 0;
+            for (int i = 0; i < cfg->depth; i++) {
+                DEA_AioSlot *slot = &run.slots[i];
+                if (slot->state == DEA_SLOT_READ && slot->seq == next_crypt) {
+                    uint8_t *data = arena + (size_t)i * cfg->block_size;
+                    dea_aio_crypt_block(plan, cfg->mode, slot->offset, data, slot->length, stats);
+                    slot->transfer = dea_aio_round_up(slot->length, files->out_direct);
+                    memset(data + slot->length, 0, slot->transfer - slot->length);
+                    slot->state = DEA_SLOT_WRITING;
+                    slot->done = 0;
+                    dea_aio_submit(&run, i, 1);
+                    next_crypt++;
+                    progress = 1;
+                }
+            }
+        }
+
+        // Refill free slots with the next unread blocks
+        for (int i = 0; i < cfg->depth && next_read < total_blocks; i++) {
+            if (run.slots[i].state == DEA_SLOT_FREE) {
+                dea_aio_start_read(&run, i, next_read++);
+            }
+        }
+    }
+
+    // After an error, let the requests still in flight finish before their buffers go away
+    while (run.in_flight > 0 && dea_uring_enter(&run.ring, run.in_flight)) {
+        unsigned head = *run.ring.cq_head;
+        unsigned tail = __atomic_load_n(run.ring.cq_tail, __ATOMIC_ACQUIRE);
+        run.in_flight -= tail - head;
+        __atomic_store_n(run.ring.cq_head, tail, __ATOMIC_RELEASE);
+    }
+
+    free(run.vecs);
+    free(run.slots);
+    dea_uring_close(&run.ring);
+    return ok;
+}
+
+#endif // DEA_HAVE_URING
+
+// Encrypt (or decrypt) the file at `input_path` into `output_path` with
+// deep asynchronous I/O from the calling thread. With io_uring, `depth`
+// block reads and writes are kept in flight around the encryption, so one
+// thread can keep an NVMe queue busy; where io_uring is unavailable (not
+// Linux, old kernel, or blocked by a container's seccomp profile) it falls
+// back to synchronous pread/pwrite. DEA_AIO=pread forces the fallback.
+// Each block is encrypted at its file offset, in file order. With `direct`
+// the page cache is bypassed, so a huge run neither fills it nor evicts
+// other processes' data. Returns 0 on failure.
+int dea_aio_crypt_file(const DEA_Plan *plan, const char *input_path, const char *output_path,
+                       const DEA_AioConfig *config, DEA_AioStats *stats) {
+    DEA_AioConfig cfg = *config;
+    if (cfg.block_size == 0) {
+        cfg.block_size = DEA_AIO_BLOCK_BYTES;
+    }
+    if (cfg.depth <= 0) {
+        cfg.depth = DEA_AIO_DEPTH;
+    }
+    if (cfg.direct) {
+        cfg.block_size = dea_aio_round_up(cfg.block_size, 1);
+    }
+    const char *forced = getenv("DEA_AIO");
+    if (forced && strcmp(forced, "pread") == 0) {
+        cfg.backend = DEA_AIO_PREAD;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->mismatch = UINT64_MAX;
+    dea_digest_init(&stats->digest);
+    stats->backend = DEA_AIO_PREAD;
+
+#ifndef DEA_HAVE_URING
+    cfg.depth = 1;   // The fallback has one block in flight
+#endif
+    uint8_t *arena = dea_aio_alloc((size_t)cfg.depth * cfg.block_size);
+    if (!arena) {
+        return 0;
+    }
+    double start = dea_aio_now();
+    int ok;
+
+#ifdef _WIN32
+    ok = dea_aio_run_sync(plan, input_path, output_path, &cfg, arena, stats);
+#else
+    DEA_AioFiles files;
+    ok = dea_aio_open_files(input_path, output_path, cfg.direct, &files);
+    stats->direct = files.in_direct && files.out_direct;
+    if (ok) {
+        int result = -1;
+#ifdef DEA_HAVE_URING
+        if (cfg.backend != DEA_AIO_PREAD) {
+            result = dea_aio_run_uring(plan, &files, &cfg, arena, stats);
+            if (result >= 0) {
+                stats->backend = DEA_AIO_URING;
+            }
+        }
+#endif
+        if (result < 0) {
+            result = cfg.backend == DEA_AIO_URING ? 0 : dea_aio_run_pread(plan, &files, &cfg, arena, stats);
+        }
+        ok = result > 0;
+    }
+    // Per-block drops can miss pages that were still being read ahead or
+    // written back; sweep both files once more
+    if (ok && files.drop_cache) {
+        if (!files.in_direct) dea_aio_drop_cache(files.in_fd, 0, 0, 0);
+        if (!files.out_direct) dea_aio_drop_cache(files.out_fd, 0, 0, 1);
+    }
+    // Cut the zero padding of an O_DIRECT final block
+    if (ok && files.out_direct && files.size % DEA_AIO_ALIGN != 0 &&
+        ftruncate(files.out_fd, (off_t)files.size) != 0) {
+        ok = 0;
+    }
+    if (files.in_fd >= 0) close(files.in_fd);
+    if (files.out_fd >= 0 && close(files.out_fd) != 0) ok = 0;
+#endif
+
+    stats->seconds = dea_aio_now() - start;
+    dea_aio_free(arena);
+    return ok;
+}
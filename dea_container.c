@@ -0,0 +1,658 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE   // pread/pwrite
+#endif
+#include "dea.h"
+#include <string.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define DEA_CONTAINER_VERSION 1
+
+static const char dea_container_magic[8] = { 'D', 'E', 'A', 'C', 'O', 'N', 'T', '1' };
+static const char dea_index_magic[8] = { 'D', 'E', 'A', 'I', 'N', 'D', 'E', 'X' };
+
+// Fixed little-endian field encoding, independent of the host byte order
+static void dea_put32(uint8_t *p, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static void dea_put64(uint8_t *p, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static uint32_t dea_get32(const uint8_t *p) {
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+static uint64_t dea_get64(const uint8_t *p) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+// Open the container file for reading or for writing (created/truncated)
+static int dea_container_open_file(const char *path, int writable, DEA_Container *container) {
+    memset(container, 0, sizeof(*container));
+    container->fd = -1;
+#ifdef _WIN32
+    HANDLE file = writable ? CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL)
+                           : CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                         FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return 0;
+    }
+    container->handle = file;
+#else
+    int fd = writable ? open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644) : open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    container->fd = fd;
+#endif
+    return 1;
+}
+
+// Positional reads and writes; safe to call from several threads at once
+static int dea_container_pread(const DEA_Container *container, uint8_t *buffer, size_t length, uint64_t offset) {
+    while (length > 0) {
+#ifdef _WIN32
+        DWORD piece = length > (1u << 30) ? (1u << 30) : (DWORD)length, n = 0;
+        OVERLAPPED at;
+        memset(&at, 0, sizeof(at));
+        at.Offset = (DWORD)offset;
+        at.OffsetHigh = (DWORD)(offset >> 32);
+        if (!ReadFile((HANDLE)container->handle, buffer, piece, &n, &at) || n == 0) return 0;
+#else
+        ssize_t n = pread(container->fd, buffer, length, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+#endif
+        buffer += n;
+        length -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return 1;
+}
+
+static int dea_container_pwrite(const DEA_Container *container, const uint8_t *buffer, size_t length,
+                                uint64_t offset) {
+    while (length > 0) {
+#ifdef _WIN32
+        DWORD piece = length > (1u << 30) ? (1u << 30) : (DWORD)length, n = 0;
+        OVERLAPPED at;
+        memset(&at, 0, sizeof(at));
+        at.Offset = (DWORD)offset;
+        at.OffsetHigh = (DWORD)(offset >> 32);
+        if (!WriteFile((HANDLE)container->handle, buffer, piece, &n, &at) || n == 0) return 0;
+#else
+        ssize_t n = pwrite(container->fd, buffer, length, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+#endif
+        buffer += n;
+        length -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return 1;
+}
+
+// Chunks are handed out to pool workers as contiguous runs
+typedef struct {
+    const DEA_Plan *plan;
+    const DEA_Container *container;
+    const uint8_t *data;       // Plaintext (write)
+    uint8_t *output;           // Plaintext (decrypt)
+    int *failed;               // Per-worker failure flags
+    uint64_t *bad_chunk;       // Per-worker first chunk that failed its check (decrypt)
+} DEA_ContainerJob;
+
+static void dea_container_write_task(void *arg, int worker, int num_workers) {
+    DEA_ContainerJob *job = (DEA_ContainerJob*)arg;
+    const DEA_Container *c = job->container;
+    uint64_t first = c->num_chunks * worker / num_workers;
+    uint64_t last = c->num_chunks * (worker + 1) / num_workers;
+    if (first == last) {
+        return;
+    }
+    uint8_t *buffer = (uint8_t*)malloc((size_t)(c->chunk_size < c->length ? c->chunk_size : c->length));
+    if (!buffer) {
+        job->failed[worker] = 1;
+        return;
+    }
+    for (uint64_t i = first; i < last; i++) {
+        DEA_ChunkEntry *entry = &c->index[i];
+        uint64_t offset = i * c->chunk_size;
+        DEA_Digest digest;
+        dea_digest_init(&digest);
+        entry->offset = DEA_CONTAINER_HEADER + offset;
+        entry->length = c->length - offset < c->chunk_size ? c->length - offset : c->chunk_size;
+        // The fused round-trip check guards against writing bad ciphertext
+        size_t bad = dea_encrypt_digest(job->plan, offset, job->data + offset, (size_t)entry->length, buffer, &digest);
+        entry->plain_crc = digest.plain_crc;
+        entry->cipher_crc = digest.cipher_crc;
+        if (bad != entry->length || !dea_container_pwrite(c, buffer, (size_t)entry->length, entry->offset)) {
+            job->failed[worker] = 1;
+            break;
+        }
+    }
+    free(buffer);
+}
+
+// Encrypt `length` bytes of plaintext into a container file at `path`,
+// `chunk_size` bytes per chunk (0 = DEA_CONTAINER_CHUNK). Pool workers
+// encrypt and write runs of chunks concurrently; the index and header are
+// written last, so an interrupted write does not leave a valid container.
+// If `digest` is not NULL it receives the whole-stream digest. Returns 0 on
+// failure.
+int dea_container_write(DEA_Pool *pool, const DEA_Plan *plan, const char *path, const uint8_t *data,
+                        size_t length, size_t chunk_size, DEA_Digest *digest) {
+    DEA_Container c;
+    if (!dea_container_open_file(path, 1, &c)) {
+        return 0;
+    }
+    c.fingerprint = dea_plan_fingerprint(plan);
+    c.num_keys = plan->num_keys;
+    c.chunk_size = chunk_size > 0 ? chunk_size : DEA_CONTAINER_CHUNK;
+    c.length = length;
+    c.num_chunks = (length + c.chunk_size - 1) / c.chunk_size;
+
+    int workers = dea_pool_threads(pool);
+    size_t index_bytes = (size_t)c.num_chunks * DEA_CONTAINER_ENTRY;
+    c.index = (DEA_ChunkEntry*)calloc((size_t)c.num_chunks + 1, sizeof(DEA_ChunkEntry));
+    int *failed = (int*)calloc((size_t)workers, sizeof(int));
+    uint8_t *footer = (uint8_t*)malloc(index_bytes + DEA_CONTAINER_TRAILER);
+    int ok = c.index && failed && footer;
+
+    if (ok) {
+        DEA_ContainerJob job = { plan, &c, data, NULL, failed, NULL };
+        dea_pool_run(pool, dea_container_write_task, &job);
+        for (int w = 0; w < workers; w++) {
+            if (failed[w]) ok = 0;
+        }
+    }
+
+    if (ok) {
+        // Footer: the index, then a trailer locating it
+        uint64_t index_offset = DEA_CONTAINER_HEADER + (uint64_t)length;
+        if (digest) {
+            dea_digest_init(digest);
+        }
+        for (uint64_t i = 0; i < c.num_chunks; i++) {
+            uint8_t *p = footer + i * DEA_CONTAINER_ENTRY;
+            dea_put64(p, c.index[i].offset);
+            dea_put64(p + 8, c.index[i].length);
+            dea_put32(p + 16, c.index[i].plain_crc);
+            dea_put32(p + 20, c.index[i].cipher_crc);
+            if (digest) {
+                DEA_Digest chunk = { c.index[i].plain_crc, c.index[i].cipher_crc, c.index[i].length };
+                dea_digest_merge(digest, &chunk);
+            }
+        }
+        uint8_t *trailer = footer + index_bytes;
+        dea_put64(trailer, index_offset);
+        dea_put64(trailer + 8, c.num_chunks);
+        dea_put32(trailer + 16, dea_crc32c(0, footer, index_bytes));
+        dea_put32(trailer + 20, 0);
+        memcpy(trailer + 24, dea_index_magic, 8);
+
+        uint8_t header[DEA_CONTAINER_HEADER];
+        memset(header, 0, sizeof(header));
+        memcpy(header, dea_container_magic, 8);
+        dea_put32(header + 8, DEA_CONTAINER_VERSION);
+        dea_put32(header + 12, (uint32_t)c.num_keys);
+        dea_put64(header + 16, c.fingerprint);
+        dea_put64(header + 24, c.chunk_size);
+        dea_put64(header + 32, c.length);
+
+        ok = dea_container_pwrite(&c, footer, index_bytes + DEA_CONTAINER_TRAILER, index_offset) &&
+             dea_container_pwrite(&c, header, sizeof(header), 0);
+    }
+
+    free(footer);
+    free(failed);
+    dea_container_close(&c);
+    return ok;
+}
+
+// Nonzero if `path` starts with the container magic
+int dea_container_probe(const char *path) {
+    DEA_Container c;
+    if (!dea_container_open_file(path, 0, &c)) {
+        return 0;
+    }
+    uint8_t magic[8];
+    int found = dea_container_pread(&c, magic, sizeof(magic), 0) &&
+                memcmp(magic, dea_container_magic, sizeof(magic)) == 0;
+    dea_container_close(&c);
+    return found;
+}
+
+// Open a container and load its index. Fails (returns 0) if the file is not
+// a well-formed container or was written with a different key set than
+// `plan`. Only the header and footer are read.
+int dea_container_open(const char *path, const DEA_Plan *plan, DEA_Container *container) {
+    if (!dea_container_open_file(path, 0, container)) {
+        return 0;
+    }
+    DEA_Container *c = container;
+    uint8_t header[DEA_CONTAINER_HEADER], trailer[DEA_CONTAINER_TRAILER];
+    uint64_t file_size;
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    int ok = GetFileSizeEx((HANDLE)c->handle, &size) != 0;
+    file_size = ok ? (uint64_t)size.QuadPart : 0;
+#else
+    struct stat st;
+    int ok = fstat(c->fd, &st) == 0;
+    file_size = ok ? (uint64_t)st.st_size : 0;
+#endif
+    ok = ok && file_size >= DEA_CONTAINER_HEADER + DEA_CONTAINER_TRAILER &&
+         dea_container_pread(c, header, sizeof(header), 0) &&
+         dea_container_pread(c, trailer, sizeof(trailer), file_size - DEA_CONTAINER_TRAILER) &&
+         memcmp(header, dea_container_magic, 8) == 0 && dea_get32(header + 8) == DEA_CONTAINER_VERSION &&
+         memcmp(trailer + 24, dea_index_magic, 8) == 0;
+    if (ok) {
+        c->num_keys = (int)dea_get32(header + 12);
+        c->fingerprint = dea_get64(header + 16);
+        c->chunk_size = dea_get64(header + 24);
+        c->length = dea_get64(header + 32);
+        c->num_chunks = dea_get64(trailer + 8);
+        uint64_t index_offset = dea_get64(trailer);
+        ok = c->num_keys == plan->num_keys && c->fingerprint == dea_plan_fingerprint(plan) &&
+             c->chunk_size > 0 && c->num_chunks == (c->length + c->chunk_size - 1) / c->chunk_size &&
+             index_offset >= DEA_CONTAINER_HEADER &&
+             index_offset + c->num_chunks * DEA_CONTAINER_ENTRY + DEA_CONTAINER_TRAILER == file_size;
+    }
+
+    uint8_t *raw = NULL;
+    if (ok) {
+        size_t index_bytes = (size_t)c->num_chunks * DEA_CONTAINER_ENTRY;
+        raw = (uint8_t*)malloc(index_bytes + 1);
+        c->index = (DEA_ChunkEntry*)calloc((size_t)c->num_chunks + 1, sizeof(DEA_ChunkEntry));
+        ok = raw && c->index && dea_container_pread(c, raw, index_bytes, dea_get64(trailer)) &&
+             dea_crc32c(0, raw, index_bytes) == dea_get32(trailer + 16);
+    }
+    // Every chunk but the last holds exactly chunk_size bytes, inside the data area
+    for (uint64_t i = 0; ok && i < c->num_chunks; i++) {
+        DEA_ChunkEntry *entry = &c->index[i];
+        const uint8_t *p = raw + i * DEA_CONTAINER_ENTRY;
+        entry->offset = dea_get64(p);
+        entry->length = dea_get64(p + 8);
+        entry->plain_crc = dea_get32(p + 16);
+        entry->cipher_crc = dea_get32(p + 20);
+        uint64_t expected = c->length - i * c->chunk_size < c->chunk_size ? c->length - i * c->chunk_size
+                                                                          : c->chunk_size;
+        ok = entry->length == expected && entry->offset >= DEA_CONTAINER_HEADER &&
+             entry->offset + entry->length <= dea_get64(trailer);
+    }
+    free(raw);
+
+    if (!ok) {
+        dea_container_close(c);
+    }
+    return ok;
+}
+
+// Decrypt `length` plaintext bytes starting at stream `offset` into
+// `output`. Only the chunks covering the range are read. No CRC32C check is
+// made, since the range may cover chunks partially (see
+// dea_container_decrypt). Returns 0 if the range is out of bounds or a read
+// fails.
+int dea_container_read(const DEA_Container *container, const DEA_Plan *plan, uint64_t offset,
+                       size_t length, uint8_t *output) {
+    if (offset > container->length || length > container->length - offset) {
+        return 0;
+    }
+    while (length > 0) {
+        uint64_t chunk = offset / container->chunk_size;
+        uint64_t within = offset - chunk * container->chunk_size;
+        const DEA_ChunkEntry *entry = &container->index[chunk];
+        size_t piece = entry->length - within < length ? (size_t)(entry->length - within) : length;
+        if (!dea_container_pread(container, output, piece, entry->offset + within)) {
+            return 0;
+        }
+        dea_crypt_at(plan, offset, output, piece, output);
+        output += piece;
+        offset += piece;
+        length -= piece;
+    }
+    return 1;
+}
+
+static void dea_container_decrypt_task(void *arg, int worker, int num_workers) {
+    DEA_ContainerJob *job = (DEA_ContainerJob*)arg;
+    const DEA_Container *c = job->container;
+    uint64_t first = c->num_chunks * worker / num_workers;
+    uint64_t last = c->num_chunks * (worker + 1) / num_workers;
+    for (uint64_t i = first; i < last; i++) {
+        const DEA_ChunkEntry *entry = &c->index[i];
+        uint64_t offset = i * c->chunk_size;
+        uint8_t *out = job->output + offset;
+        if (!dea_container_pread(c, out, (size_t)entry->length, entry->offset)) {
+            job->failed[worker] = 1;
+            job->bad_chunk[worker] = i;
+            return;
+        }
+        // Decrypting is encrypting, so the digest's "plain" side covers the
+        // ciphertext read from disk and its "cipher" side the plaintext
+        DEA_Digest digest;
+        dea_digest_init(&digest);
+        dea_encrypt_digest(job->plan, offset, out, (size_t)entry->length, out, &digest);
+        if (digest.plain_crc != entry->cipher_crc || digest.cipher_crc != entry->plain_crc) {
+            job->bad_chunk[worker] = i;
+            return;
+        }
+    }
+}
+
+// Decrypt the whole container into `output` (container->length bytes),
+// with pool workers reading and decrypting runs of chunks concurrently.
+// Every chunk's ciphertext and plaintext are checked against the CRC32C
+// values in the index. Returns 0 on a read error or a corrupt chunk; if
+// `bad_chunk` is not NULL it receives the first chunk that could not be
+// read or failed its check (UINT64_MAX if none).
+int dea_container_decrypt(DEA_Pool *pool, const DEA_Container *container, const DEA_Plan *plan,
+                          uint8_t *output, uint64_t *bad_chunk) {
+    int workers = dea_pool_threads(pool);
+    int *failed = (int*)calloc((size_t)workers, sizeof(int));
+    uint64_t *bad = (uint64_t*)malloc((size_t)workers * sizeof(uint64_t));
+    uint64_t first_bad = UINT64_MAX;
+    int ok = failed && bad;
+
+    if (ok) {
+        for (int w = 0; w < workers; w++) {
+            bad[w] = UINT64_MAX;
+        }
+        DEA_ContainerJob job = { plan, container, NULL, output, failed, bad };
+        dea_pool_run(pool, dea_container_decrypt_task, &job);
+        for (int w = 0; w < workers; w++) {
+            if (failed[w] || bad[w] != UINT64_MAX) ok = 0;
+            if (bad[w] < first_bad) first_bad = bad[w];
+        }
+    }
+    if (bad_chunk) {
+        *bad_chunk = first_bad;
+    }
+
+    free(failed);
+    free(bad);
+    return ok;
+}
+
+void dea_container_close(DEA_Container *container) {
+#ifdef _WIN32
+    if (container->handle) {
+        CloseHandle((HANDLE)container->handle);
+    }
+#else
+    if (container->fd >= 0) {
+        close(container->fd);
+    }
+#endif
+    free(container->index);
+    memset(container, 0, sizeof(*container));
+    container->fd = -1;
+}
+
+// Random-access decrypting reader. Decrypted pages live in a fixed set of
+// slots found through a hash of the page number; the slots also form a
+// doubly linked list from most to least recently used, and a miss reuses
+// the least recently used slot.
+#define DEA_READER_PAGE (64 * 1024)
+#define DEA_READER_PAGES 64
+
+typedef struct {
+    uint64_t page;             // Page number held (UINT64_MAX if the slot is free)
+    uint8_t *data;
+    size_t length;             // Valid bytes (short for the last page of the file)
+    int newer, older;          // LRU list links (-1 at the ends)
+    int next;                  // Hash chain link (-1 at the end)
+} DEA_ReaderSlot;
+
+struct DEA_Reader {
+    DEA_Container file;        // A raw ciphertext file is described as one chunk
+    const DEA_Plan *plan;
+    size_t page_size;
+    int num_slots;
+    DEA_ReaderSlot *slots;
+    uint8_t *memory;
+    int *buckets;              // Hash heads, indexed by page & bucket_mask
+    uint64_t bucket_mask;
+    int newest, oldest;
+    uint64_t hits, misses;
+    int error;
+    pthread_mutex_t lock;
+};
+
+// Open `path` for random-access reads of its plaintext. A container is
+// located through its index (and must match the plan's key set); any other
+// file is taken as raw ciphertext, such as the binary output of
+// dea_aio_crypt_file, with byte i at stream offset i. Up to `cache_pages`
+// decrypted pages of `page_size` bytes are kept (0 = 64 pages of 64 KB).
+// The plan must outlive the reader. Returns NULL on failure.
+DEA_Reader *dea_reader_open(const char *path, const DEA_Plan *plan, size_t page_size, int cache_pages) {
+    DEA_Reader *reader = (DEA_Reader*)calloc(1, sizeof(DEA_Reader));
+    if (!reader) {
+        return NULL;
+    }
+    reader->plan = plan;
+    reader->page_size = page_size > 0 ? page_size : DEA_READER_PAGE;
+    reader->num_slots = cache_pages > 0 ? cache_pages : DEA_READER_PAGES;
+
+    int ok;
+    if (dea_container_probe(path)) {
+        ok = dea_container_open(path, plan, &reader->file);
+    } else {
+        DEA_Container *c = &reader->file;
+        ok = dea_container_open_file(path, 0, c);
+#ifdef _WIN32
+        LARGE_INTEGER size;
+        ok = ok && GetFileSizeEx((HANDLE)c->handle, &size);
+        c->length = ok ? (uint64_t)size.QuadPart : 0;
+#else
+        struct stat st;
+        ok = ok && fstat(c->fd, &st) == 0;
+        c->length = ok ? (uint64_t)st.st_size : 0;
+#endif
+        c->chunk_size = c->length > 0 ? c->length : 1;
+        c->num_chunks = c->length > 0 ? 1 : 0;
+        c->index = (DEA_ChunkEntry*)calloc(1, sizeof(DEA_ChunkEntry));
+        ok = ok && c->index;
+        if (ok) {
+            c->index[0].length = c->length;
+        }
+    }
+
+    uint64_t buckets = 1;
+    while (buckets < 2 * (uint64_t)reader->num_slots) {
+        buckets <<= 1;
+    }
+    reader->bucket_mask = buckets - 1;
+    reader->slots = (DEA_ReaderSlot*)calloc((size_t)reader->num_slots, sizeof(DEA_ReaderSlot));
+    reader->memory = (uint8_t*)malloc(reader->page_size * (size_t)reader->num_slots);
+    reader->buckets = (int*)malloc((size_t)buckets * sizeof(int));
+    if (!ok || !reader->slots || !reader->memory || !reader->buckets) {
+        dea_container_close(&reader->file);
+        free(reader->slots);
+        free(reader->memory);
+        free(reader->buckets);
+        free(reader);
+        return NULL;
+    }
+
+    for (uint64_t b = 0; b < buckets; b++) {
+        reader->buckets[b] = -1;
+    }
+    // All slots start free, in LRU order 0 (newest) .. num_slots - 1 (oldest)
+    for (int i = 0; i < reader->num_slots; i++) {
+        DEA_ReaderSlot *slot = &reader->slots[i];
+        slot->page = UINT64_MAX;
+        slot->data = reader->memory + (size_t)i * reader->page_size;
+        slot->newer = i - 1;
+        slot->older = i + 1 < reader->num_slots ? i + 1 : -1;
+        slot->next = -1;
+    }
+    reader->newest = 0;
+    reader->oldest = reader->num_slots - 1;
+    pthread_mutex_init(&reader->lock, NULL);
+    return reader;
+}
+
+// Plaintext size of the file
+uint64_t dea_reader_size(const DEA_Reader *reader) {
+    return reader->file.length;
+}
+
+// Move a slot to the most recently used end of the list
+static void dea_reader_touch(DEA_Reader *reader, int index) {
+    DEA_ReaderSlot *slot = &reader->slots[index];
+    if (reader->newest == index) {
+        return;
+    }
+    reader->slots[slot->newer].older = slot->older;
+    if (slot->older >= 0) {
+        reader->slots[slot->older].newer = slot->newer;
+    } else {
+        reader->oldest = slot->newer;
+    }
+    slot->newer = -1;
+    slot->older = reader->newest;
+    reader->slots[reader->newest].newer = index;
+    reader->newest = index;
+}
+
+// Slot holding `page`, decrypting it into the least recently used slot on
+// a miss. Returns -1 if the page could not be read.
+static int dea_reader_page(DEA_Reader *reader, uint64_t page) {
+    int *head = &reader->buckets[page & reader->bucket_mask];
+    for (int i = *head; i >= 0; i = reader->slots[i].next) {
+        if (reader->slots[i].page == page) {
+            reader->hits++;
+            dea_reader_touch(reader, i);
+            return i;
+        }
+    }
+
+    reader->misses++;
+    int index = reader->oldest;
+    DEA_ReaderSlot *slot = &reader->slots[index];
+    if (slot->page != UINT64_MAX) {
+        // Evict: unlink the old page from its hash chain
+        int *link = &reader->buckets[slot->page & reader->bucket_mask];
+        while (*link != index) {
+            link = &reader->slots[*link].next;
+        }
+        *link = slot->next;
+    }
+    uint64_t offset = page * reader->page_size;
+    uint64_t remaining = reader->file.length - offset;
+    slot->length = remaining < reader->page_size ? (size_t)remaining : reader->page_size;
+    if (!dea_container_read(&reader->file, reader->plan, offset, slot->length, slot->data)) {
+        slot->page = UINT64_MAX;
+        slot->next = -1;
+        return -1;
+    }
+    slot->page = page;
+    slot->next = *head;
+    *head = index;
+    dea_reader_touch(reader, index);
+    return index;
+}
+
+// Read up to `length` plaintext bytes at `offset` into `buffer`, like
+// pread: returns the number of bytes read, fewer at the end of the file.
+// Touched pages come from the cache or are decrypted on demand (the key
+// phase follows from the offset); pages the read covers whole that are not
+// cached are decrypted straight into `buffer`, so long scans do not flush
+// the cache. Safe to call from several threads. On a read error the bytes
+// before it are returned and dea_reader_error turns nonzero.
+size_t dea_reader_pread(DEA_Reader *reader, void *buffer, size_t length, uint64_t offset) {
+    uint8_t *out = (uint8_t*)buffer;
+    if (offset >= reader->file.length) {
+        return 0;
+    }
+    if (length > reader->file.length - offset) {
+        length = (size_t)(reader->file.length - offset);
+    }
+
+    size_t done = 0;
+    pthread_mutex_lock(&reader->lock);
+    while (done < length) {
+        uint64_t position = offset + done;
+        uint64_t page = position / reader->page_size;
+        size_t within = (size_t)(position - page * reader->page_size);
+        size_t piece = reader->page_size - within;
+        if (piece > length - done) {
+            piece = length - done;
+        }
+
+        if (within == 0 && piece == reader->page_size) {
+            // A whole page: copy it if cached, else decrypt it in place
+            int cached = -1;
+            for (int i = reader->buckets[page & reader->bucket_mask]; i >= 0; i = reader->slots[i].next) {
+                if (reader->slots[i].page == page) {
+                    cached = i;
+                    break;
+                }
+            }
+            if (cached < 0) {
+                if (!dea_container_read(&reader->file, reader->plan, position, piece, out + done)) {
+                    reader->error = 1;
+                    break;
+                }
+                done += piece;
+                continue;
+            }
+        }
+
+        int index = dea_reader_page(reader, page);
+        if (index < 0) {
+            reader->error = 1;
+            break;
+        }
+        memcpy(out + done, reader->slots[index].data + within, piece);
+        done += piece;
+    }
+    pthread_mutex_unlock(&reader->lock);
+    return done;
+}
+
+// Nonzero if a read failed
+int dea_reader_error(const DEA_Reader *reader) {
+    return reader->error;
+}
+
+// Page lookups served from the cache and decrypted on demand so far
+void dea_reader_stats(const DEA_Reader *reader, uint64_t *hits, uint64_t *misses) {
+    *hits = reader->hits;
+    *misses = reader->misses;
+}
+
+void dea_reader_close(DEA_Reader *reader) {
+    if (!reader) {
+        return;
+    }
+    pthread_mutex_destroy(&reader->lock);
+    dea_container_close(&reader->file);
+    free(reader->slots);
+    free(reader->memory);
+    free(reader->buckets);
+    free(reader);
+}
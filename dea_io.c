@@ -0,0 +1,410 @@
+#include "dea.h"
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Map an existing file read-only for a single sequential pass. Pages are
+// read from the page cache on first touch, so nothing is copied up front.
+// Returns 0 on failure.
+int dea_map_input(const char *path, DEA_Mapping *map) {
+    memset(map, 0, sizeof(*map));
+    map->fd = -1;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return 0;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return 0;
+    }
+    map->size = (size_t)size.QuadPart;
+    if (map->size > 0) {
+        HANDLE section = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (section) {
+            map->data = (uint8_t*)MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(section);
+        }
+        if (!map->data) {
+            CloseHandle(file);
+            return 0;
+        }
+    }
+    map->handle = file;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 0;
+    }
+    map->size = (size_t)st.st_size;
+    if (map->size > 0) {
+        void *data = mmap(NULL, map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return 0;
+        }
+        madvise(data, map->size, MADV_SEQUENTIAL);
+        map->data = (uint8_t*)data;
+    }
+    map->fd = fd;
+#endif
+    return 1;
+}
+
+// Create (or truncate) a file of `size` bytes and map it read-write.
+// Stores into the mapping go to the page cache and are written back by the
+// OS, so no write() copy is needed. The space is reserved up front so a
+// full disk fails here rather than as a fault on store. Returns 0 on failure.
+int dea_map_output(const char *path, size_t size, DEA_Mapping *map) {
+    memset(map, 0, sizeof(*map));
+    map->fd = -1;
+    map->size = size;
+    map->writable = 1;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return 0;
+    }
+    if (size > 0) {
+        // Mapping a section larger than the file extends the file
+        HANDLE section = CreateFileMappingA(file, NULL, PAGE_READWRITE,
+                                            (DWORD)((uint64_t)size >> 32), (DWORD)size, NULL);
+        if (section) {
+            map->data = (uint8_t*)MapViewOfFile(section, FILE_MAP_WRITE, 0, 0, size);
+            CloseHandle(section);
+        }
+        if (!map->data) {
+            CloseHandle(file);
+            return 0;
+        }
+    }
+    map->handle = file;
+#else
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return 0;
+    }
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        return 0;
+    }
+    if (size > 0) {
+        int err = posix_fallocate(fd, 0, (off_t)size);
+        if (err != 0 && err != EINVAL && err != EOPNOTSUPP) {
+            close(fd);
+            return 0;
+        }
+        void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return 0;
+        }
+        madvise(data, size, MADV_SEQUENTIAL);
+        map->data = (uint8_t*)data;
+    }
+    map->fd = fd;
+#endif
+    return 1;
+}
+
+// Unmap and close. Dirty pages of an output mapping stay in the page cache
+// and are written back by the OS as for a regular write().
+void dea_unmap(DEA_Mapping *map) {
+#ifdef _WIN32
+    if (map->data) {
+        UnmapViewOfFile(map->data);
+    }
+    if (map->handle) {
+        CloseHandle((HANDLE)map->handle);
+    }
+#else
+    if (map->data) {
+        munmap(map->data, map->size);
+    }
+    if (map->fd >= 0) {
+        close(map->fd);
+    }
+#endif
+    memset(map, 0, sizeof(*map));
+    map->fd = -1;
+}
+
+// Double-buffered sequential reader. A background thread reads window k+1
+// while the caller works on window k, so disk reads overlap with
+// encryption and only two windows are ever allocated.
+struct DEA_Stream {
+    FILE *file;
+    size_t window;
+    uint8_t *buffers[2];
+    size_t lengths[2];
+    int filled[2];             // Slot holds a window not yet returned to the reader thread
+    int held;                  // Slot currently handed to the caller (-1 if none)
+    unsigned long consumed;    // Windows handed to the caller so far
+    uint64_t offset;           // Stream offset of the next window
+    int error;
+    int shutdown;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+};
+
+static void *dea_stream_reader(void *arg) {
+    DEA_Stream *stream = (DEA_Stream*)arg;
+    for (unsigned long seq = 0;; seq++) {
+        int slot = (int)(seq & 1);
+        pthread_mutex_lock(&stream->lock);
+        while (stream->filled[slot] && !stream->shutdown) {
+            pthread_cond_wait(&stream->changed, &stream->lock);
+        }
+        if (stream->shutdown) {
+            pthread_mutex_unlock(&stream->lock);
+            break;
+        }
+        pthread_mutex_unlock(&stream->lock);
+
+        size_t length = fread(stream->buffers[slot], 1, stream->window, stream->file);
+        int failed = length < stream->window && ferror(stream->file);
+
+        pthread_mutex_lock(&stream->lock);
+        stream->lengths[slot] = length;
+        stream->filled[slot] = 1;
+        stream->error |= failed;
+        pthread_cond_broadcast(&stream->changed);
+        pthread_mutex_unlock(&stream->lock);
+
+        // A short read is the end of the file; the empty window after it marks EOF
+        if (length == 0) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+// Open `path` for sequential reading in windows of `window` bytes. Returns
+// NULL on failure.
+DEA_Stream *dea_stream_open(const char *path, size_t window) {
+    if (window == 0) {
+        return NULL;
+    }
+    DEA_Stream *stream = (DEA_Stream*)calloc(1, sizeof(DEA_Stream));
+    if (!stream) {
+        return NULL;
+    }
+    stream->file = fopen(path, "rb");
+    stream->buffers[0] = (uint8_t*)malloc(window);
+    stream->buffers[1] = (uint8_t*)malloc(window);
+    if (!stream->file || !stream->buffers[0] || !stream->buffers[1]) {
+        if (stream->file) fclose(stream->file);
+        free(stream->buffers[0]);
+        free(stream->buffers[1]);
+        free(stream);
+        return NULL;
+    }
+    // fread straight into the window buffers, without a stdio staging copy
+    setvbuf(stream->file, NULL, _IONBF, 0);
+    stream->window = window;
+    stream->held = -1;
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_cond_init(&stream->changed, NULL);
+    if (pthread_create(&stream->thread, NULL, dea_stream_reader, stream) != 0) {
+        pthread_cond_destroy(&stream->changed);
+        pthread_mutex_destroy(&stream->lock);
+        fclose(stream->file);
+        free(stream->buffers[0]);
+        free(stream->buffers[1]);
+        free(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+// Hand the next window to the caller, returning the previous one to the
+// reader. `*data` stays valid, and may be modified in place, until the next
+// call. `*offset` is the window's offset in the file. Returns the window
+// length, or 0 at the end of the file.
+size_t dea_stream_next(DEA_Stream *stream, uint8_t **data, uint64_t *offset) {
+    pthread_mutex_lock(&stream->lock);
+    if (stream->held >= 0) {
+        stream->filled[stream->held] = 0;
+        stream->held = -1;
+        pthread_cond_broadcast(&stream->changed);
+    }
+
+    int slot = (int)(stream->consumed & 1);
+    while (!stream->filled[slot]) {
+        pthread_cond_wait(&stream->changed, &stream->lock);
+    }
+    size_t length = stream->lengths[slot];
+    if (length > 0) {
+        stream->held = slot;
+        stream->consumed++;
+        *data = stream->buffers[slot];
+        *offset = stream->offset;
+        stream->offset += length;
+    }
+    pthread_mutex_unlock(&stream->lock);
+    return length;
+}
+
+// Nonzero if a read error ended the stream early
+int dea_stream_error(const DEA_Stream *stream) {
+    return stream->error;
+}
+
+void dea_stream_close(DEA_Stream *stream) {
+    if (!stream) {
+        return;
+    }
+    pthread_mutex_lock(&stream->lock);
+    stream->shutdown = 1;
+    pthread_cond_broadcast(&stream->changed);
+    pthread_mutex_unlock(&stream->lock);
+    pthread_join(stream->thread, NULL);
+
+    pthread_cond_destroy(&stream->changed);
+    pthread_mutex_destroy(&stream->lock);
+    fclose(stream->file);
+    free(stream->buffers[0]);
+    free(stream->buffers[1]);
+    free(stream);
+}
+
+// Bytes formatted per write by dea_write_decimal
+#define DEA_DECIMAL_BLOCK 65536
+
+typedef struct {
+    const uint8_t *data;
+    size_t *bounds;            // Slice boundaries, one slice per worker
+    uint64_t *offsets;         // Text length of each slice, then its file offset
+    int *failed;               // Per-worker write failure flags
+    int fd;
+    int phase;                 // 0 = measure the slices, 1 = format and write them
+} DEA_DecimalJob;
+
+#ifndef _WIN32
+static int dea_pwrite_full(int fd, const char *text, size_t length, uint64_t offset) {
+    while (length > 0) {
+        ssize_t n = pwrite(fd, text, length, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        text += n;
+        length -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return 1;
+}
+
+static void dea_decimal_task(void *arg, int worker, int num_workers) {
+    DEA_DecimalJob *job = (DEA_DecimalJob*)arg;
+    (void)num_workers;
+    const uint8_t *data = job->data + job->bounds[worker];
+    size_t length = job->bounds[worker + 1] - job->bounds[worker];
+    if (job->phase == 0) {
+        job->offsets[worker] = dea_decimal_length(data, length);
+        return;
+    }
+    if (length == 0) {
+        return;
+    }
+    char *text = (char*)malloc(DEA_DECIMAL_BLOCK * DEA_DECIMAL_MAX_CHARS);
+    if (!text) {
+        job->failed[worker] = 1;
+        return;
+    }
+    uint64_t offset = job->offsets[worker];
+    for (size_t i = 0; i < length; i += DEA_DECIMAL_BLOCK) {
+        size_t count = length - i < DEA_DECIMAL_BLOCK ? length - i : DEA_DECIMAL_BLOCK;
+        size_t chars = dea_format_decimal(data + i, count, text);
+        if (!dea_pwrite_full(job->fd, text, chars, offset)) {
+            job->failed[worker] = 1;
+            break;
+        }
+        offset += chars;
+    }
+    free(text);
+}
+#endif
+
+// Write `length` bytes to `path` as ASCII decimal text (dea_format_decimal).
+// The data is split into one slice per pool worker. A first pass counts the
+// characters of every slice; an exclusive prefix sum of those counts gives
+// each slice's file offset, so the second pass formats and pwrites all
+// slices concurrently instead of serializing the text on one thread. On
+// Windows the text is written sequentially. Returns 0 on failure.
+int dea_write_decimal(DEA_Pool *pool, const char *path, const uint8_t *data, size_t length) {
+#ifdef _WIN32
+    (void)pool;
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        return 0;
+    }
+    char *text = (char*)malloc(DEA_DECIMAL_BLOCK * DEA_DECIMAL_MAX_CHARS);
+    int ok = text != NULL;
+    for (size_t i = 0; ok && i < length; i += DEA_DECIMAL_BLOCK) {
+        size_t count = length - i < DEA_DECIMAL_BLOCK ? length - i : DEA_DECIMAL_BLOCK;
+        size_t chars = dea_format_decimal(data + i, count, text);
+        ok = fwrite(text, 1, chars, file) == chars;
+    }
+    free(text);
+    if (fclose(file) != 0) {
+        ok = 0;
+    }
+    return ok;
+#else
+    int workers = dea_pool_threads(pool);
+    size_t *bounds = (size_t*)malloc((size_t)(workers + 1) * sizeof(size_t));
+    uint64_t *offsets = (uint64_t*)malloc((size_t)workers * sizeof(uint64_t));
+    int *failed = (int*)calloc((size_t)workers, sizeof(int));
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int ok = bounds && offsets && failed && fd >= 0;
+
+    if (ok) {
+        dea_partition(length, workers, 1, DEA_CACHE_LINE, bounds);
+        DEA_DecimalJob job = { data, bounds, offsets, failed, fd, 0 };
+        dea_pool_run(pool, dea_decimal_task, &job);
+
+        // Exclusive prefix sum: each slice starts where the text before it ends
+        uint64_t total = 0;
+        for (int w = 0; w < workers; w++) {
+            uint64_t chars = offsets[w];
+            offsets[w] = total;
+            total += chars;
+        }
+
+        // Size the file up front so the slices can land in any order
+        ok = ftruncate(fd, (off_t)total) == 0;
+        if (ok) {
+            job.phase = 1;
+            dea_pool_run(pool, dea_decimal_task, &job);
+            for (int w = 0; w < workers; w++) {
+                if (failed[w]) ok = 0;
+            }
+        }
+    }
+
+    if (fd >= 0 && close(fd) != 0) {
+        ok = 0;
+    }
+    free(bounds);
+    free(offsets);
+    free(failed);
+    return ok;
+#endif
+}
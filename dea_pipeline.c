@@ -0,0 +1,414 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE   // nanosleep
+#endif
+#include "dea.h"
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define DEA_PAUSE() _mm_pause()
+#else
+#define DEA_PAUSE() ((void)0)
+#endif
+
+#define DEA_PIPELINE_BLOCK_BYTES (4 * 1024 * 1024)
+#define DEA_PIPELINE_STOP (-1)   // Work-ring token telling a worker to exit
+
+// Bounded lock-free MPMC ring of block indices (Vyukov's sequence-numbered
+// cells). Each cell's sequence says whether it is ready for the next push
+// or the next pop, so producers and consumers only contend on their own
+// index. Capacity is a power of two.
+typedef struct {
+    _Atomic size_t sequence;
+    int value;
+} DEA_RingCell;
+
+typedef struct {
+    DEA_RingCell *cells;
+    size_t mask;
+    DEA_ALIGNED(64) _Atomic size_t head;   // Next push position
+    DEA_ALIGNED(64) _Atomic size_t tail;   // Next pop position
+} DEA_Ring;
+
+static int dea_ring_init(DEA_Ring *ring, size_t min_capacity) {
+    size_t capacity = 2;
+    while (capacity < min_capacity) {
+        capacity <<= 1;
+    }
+    ring->cells = (DEA_RingCell*)malloc(capacity * sizeof(DEA_RingCell));
+    if (!ring->cells) {
+        return 0;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        atomic_init(&ring->cells[i].sequence, i);
+    }
+    ring->mask = capacity - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return 1;
+}
+
+static int dea_ring_push(DEA_Ring *ring, int value) {
+    size_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    DEA_RingCell *cell;
+    for (;;) {
+        cell = &ring->cells[pos & ring->mask];
+        size_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return 0;   // Full
+        } else {
+            pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        }
+    }
+    cell->value = value;
+    atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+    return 1;
+}
+
+static int dea_ring_pop(DEA_Ring *ring, int *value) {
+    size_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    DEA_RingCell *cell;
+    for (;;) {
+        cell = &ring->cells[pos & ring->mask];
+        size_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return 0;   // Empty
+        } else {
+            pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        }
+    }
+    *value = cell->value;
+    atomic_store_explicit(&cell->sequence, pos + ring->mask + 1, memory_order_release);
+    return 1;
+}
+
+// Back off while a ring is empty or full: spin briefly, then yield, then
+// sleep, so an idle stage does not burn a core another stage could use
+static void dea_ring_backoff(unsigned *spins) {
+    if (*spins < 64) {
+        DEA_PAUSE();
+    } else if (*spins < 128) {
+        sched_yield();
+    } else {
+#ifdef _WIN32
+        Sleep(0);
+#else
+        struct timespec pause = { 0, 50 * 1000 };
+        nanosleep(&pause, NULL);
+#endif
+    }
+    (*spins)++;
+}
+
+typedef struct {
+    uint8_t *data;
+    size_t length;
+    uint64_t offset;            // Stream offset of the first byte
+    uint64_t seq;               // Position in the stream, for the ordered writer
+    size_t mismatch;            // First round-trip mismatch in the block, or length
+    DEA_Digest digest;          // Block digest (DEA_PIPE_DIGEST)
+} DEA_Block;
+
+typedef struct {
+    const DEA_Plan *plan;
+    const DEA_PipelineConfig *config;
+    dea_read_fn read;
+    void *read_ctx;
+    dea_write_fn write;
+    void *write_ctx;
+
+    DEA_Block *blocks;
+    int num_blocks;
+    DEA_Ring free_ring;         // Writer -> reader: blocks ready to be refilled
+    DEA_Ring work_ring;         // Reader -> workers: blocks to encrypt
+    DEA_Ring done_ring;         // Workers -> writer: encrypted blocks, any order
+    int *pending;               // Writer's reorder slots
+
+    _Atomic uint64_t total_blocks;   // Set by the reader at end of stream
+    _Atomic int reader_done;
+    _Atomic int failed;         // Read or write error: stop reading, drain the rest
+
+    double read_busy, write_busy;
+    double *encrypt_busy;       // Per worker
+} DEA_Pipeline;
+
+typedef struct {
+    DEA_Pipeline *pipe;
+    int id;
+} DEA_PipelineWorker;
+
+static double dea_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *dea_pipeline_reader(void *arg) {
+    DEA_Pipeline *pipe = (DEA_Pipeline*)arg;
+    size_t block_size = pipe->config->block_size;
+    uint64_t seq = 0, offset = 0;
+    unsigned spins = 0;
+
+    while (!atomic_load(&pipe->failed)) {
+        int index;
+        if (!dea_ring_pop(&pipe->free_ring, &index)) {
+            dea_ring_backoff(&spins);
+            continue;
+        }
+        spins = 0;
+
+        DEA_Block *block = &pipe->blocks[index];
+        double start = dea_now();
+        size_t length = pipe->read(pipe->read_ctx, block->data, block_size);
+        pipe->read_busy += dea_now() - start;
+        if (length == (size_t)-1) {
+            atomic_store(&pipe->failed, 1);
+            break;
+        }
+        if (length == 0) {
+            break;
+        }
+
+        block->length = length;
+        block->offset = offset;
+        block->seq = seq++;
+        offset += length;
+        while (!dea_ring_push(&pipe->work_ring, index)) {
+            dea_ring_backoff(&spins);
+        }
+        spins = 0;
+    }
+
+    atomic_store(&pipe->total_blocks, seq);
+    atomic_store(&pipe->reader_done, 1);
+    for (int w = 0; w < pipe->config->workers; w++) {
+        while (!dea_ring_push(&pipe->work_ring, DEA_PIPELINE_STOP)) {
+            dea_ring_backoff(&spins);
+        }
+    }
+    return NULL;
+}
+
+static void *dea_pipeline_worker(void *arg) {
+    DEA_PipelineWorker *self = (DEA_PipelineWorker*)arg;
+    DEA_Pipeline *pipe = self->pipe;
+    const DEA_Plan *plan = pipe->plan;
+    int mode = pipe->config->mode;
+    unsigned spins = 0;
+
+    for (;;) {
+        int index;
+        if (!dea_ring_pop(&pipe->work_ring, &index)) {
+            dea_ring_backoff(&spins);
+            continue;
+        }
+        spins = 0;
+        if (index == DEA_PIPELINE_STOP) {
+            break;
+        }
+
+        DEA_Block *block = &pipe->blocks[index];
+        double start = dea_now();
+        block->mismatch = block->length;
+        if (mode == DEA_PIPE_DIGEST) {
+            dea_digest_init(&block->digest);
+            block->mismatch = dea_encrypt_digest(plan, block->offset, block->data, block->length,
+                                                 block->data, &block->digest);
+        } else if (mode == DEA_PIPE_VERIFY) {
+            block->mismatch = dea_encrypt_verified(plan, block->offset, block->data, block->length, block->data);
+        } else {
+            dea_crypt_at(plan, block->offset, block->data, block->length, block->data);
+        }
+        pipe->encrypt_busy[self->id] += dea_now() - start;
+
+        while (!dea_ring_push(&pipe->done_ring, index)) {
+            dea_ring_backoff(&spins);
+        }
+        spins = 0;
+    }
+    return NULL;
+}
+
+// The writer runs on the calling thread. Blocks arrive in any order and are
+// parked in `pending` (slot seq % num_blocks is unique, since at most
+// num_blocks are in flight) until the next one in sequence is there.
+static void dea_pipeline_writer(DEA_Pipeline *pipe, DEA_PipelineStats *stats) {
+    int *pending = pipe->pending;
+    for (int i = 0; i < pipe->num_blocks; i++) {
+        pending[i] = -1;
+    }
+    uint64_t next = 0;
+    unsigned spins = 0;
+
+    for (;;) {
+        int index;
+        if (dea_ring_pop(&pipe->done_ring, &index)) {
+            spins = 0;
+            pending[pipe->blocks[index].seq % (uint64_t)pipe->num_blocks] = index;
+        } else if (atomic_load(&pipe->reader_done) && next == atomic_load(&pipe->total_blocks)) {
+            break;
+        } else {
+            dea_ring_backoff(&spins);
+        }
+
+        // Write out every block that is now in order
+        int slot;
+        while ((slot = (int)(next % (uint64_t)pipe->num_blocks), pending[slot] >= 0)) {
+            DEA_Block *block = &pipe->blocks[pending[slot]];
+            pending[slot] = -1;
+
+            if (block->mismatch != block->length && stats->mismatch == UINT64_MAX) {
+                stats->mismatch = block->offset + block->mismatch;
+            }
+            if (pipe->config->mode == DEA_PIPE_DIGEST) {
+                dea_digest_merge(&stats->digest, &block->digest);
+            }
+            if (!atomic_load(&pipe->failed)) {
+                double start = dea_now();
+                if (!pipe->write(pipe->write_ctx, block->data, block->length, block->offset)) {
+                    atomic_store(&pipe->failed, 1);
+                }
+                pipe->write_busy += dea_now() - start;
+            }
+            stats->bytes += block->length;
+            next++;
+
+            int index_back = (int)(block - pipe->blocks);
+            while (!dea_ring_push(&pipe->free_ring, index_back)) {
+                dea_ring_backoff(&spins);
+            }
+        }
+    }
+}
+
+// Run `read` -> encrypt -> `write` as a three-stage pipeline: one reader
+// thread, `config->workers` encryption threads and an ordered writer on the
+// calling thread, passing pooled blocks through lock-free rings. While the
+// writer handles block k, workers encrypt later blocks and the reader
+// fills the next free one, so the run takes about as long as the slowest
+// stage rather than the sum of all three. Blocks are encrypted in place at
+// their stream offset and handed to `write` in stream order. `read` returns
+// the bytes read (0 at end of file, (size_t)-1 on error); `write` returns 0
+// on error. Returns 0 if the pipeline could not be set up or an I/O
+// callback failed.
+int dea_pipeline_run(const DEA_Plan *plan, const DEA_PipelineConfig *config,
+                     dea_read_fn read, void *read_ctx, dea_write_fn write, void *write_ctx,
+                     DEA_PipelineStats *stats) {
+    DEA_PipelineConfig cfg = *config;
+    if (cfg.workers <= 0) {
+        cfg.workers = dea_default_threads();
+    }
+    if (cfg.block_size == 0) {
+        cfg.block_size = DEA_PIPELINE_BLOCK_BYTES;
+    }
+    if (cfg.blocks <= 0) {
+        cfg.blocks = 2 * cfg.workers + 2;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->mismatch = UINT64_MAX;
+    dea_digest_init(&stats->digest);
+
+    DEA_Pipeline pipe;
+    memset(&pipe, 0, sizeof(pipe));
+    pipe.plan = plan;
+    pipe.config = &cfg;
+    pipe.read = read;
+    pipe.read_ctx = read_ctx;
+    pipe.write = write;
+    pipe.write_ctx = write_ctx;
+    pipe.num_blocks = cfg.blocks;
+    atomic_init(&pipe.total_blocks, 0);
+    atomic_init(&pipe.reader_done, 0);
+    atomic_init(&pipe.failed, 0);
+
+    // Rings hold every block plus the workers' stop tokens, so pushes to
+    // the work ring only wait on workers, never on ring capacity
+    size_t ring_size = (size_t)cfg.blocks + (size_t)cfg.workers;
+    pipe.blocks = (DEA_Block*)calloc((size_t)cfg.blocks, sizeof(DEA_Block));
+    uint8_t *arena = (uint8_t*)malloc((size_t)cfg.blocks * cfg.block_size);
+    pipe.encrypt_busy = (double*)calloc((size_t)cfg.workers, sizeof(double));
+    pthread_t *threads = (pthread_t*)calloc((size_t)cfg.workers + 1, sizeof(pthread_t));
+    DEA_PipelineWorker *workers = (DEA_PipelineWorker*)calloc((size_t)cfg.workers, sizeof(DEA_PipelineWorker));
+    pipe.pending = (int*)malloc((size_t)cfg.blocks * sizeof(int));
+    int rings = 0;
+    if (pipe.blocks && arena && pipe.encrypt_busy && threads && workers && pipe.pending) {
+        rings += dea_ring_init(&pipe.free_ring, ring_size);
+        rings += dea_ring_init(&pipe.work_ring, ring_size);
+        rings += dea_ring_init(&pipe.done_ring, ring_size);
+    }
+
+    int started = 0;
+    if (rings == 3) {
+        for (int i = 0; i < cfg.blocks; i++) {
+            pipe.blocks[i].data = arena + (size_t)i * cfg.block_size;
+            dea_ring_push(&pipe.free_ring, i);
+        }
+
+        double start = dea_now();
+        if (pthread_create(&threads[0], NULL, dea_pipeline_reader, &pipe) == 0) {
+            started = 1;
+            for (int w = 0; w < cfg.workers; w++) {
+                workers[w].pipe = &pipe;
+                workers[w].id = w;
+                if (pthread_create(&threads[w + 1], NULL, dea_pipeline_worker, &workers[w]) != 0) {
+                    // Run with fewer workers; their stop tokens are left in the ring
+                    break;
+                }
+                started++;
+            }
+        }
+
+        if (started > 1) {
+            dea_pipeline_writer(&pipe, stats);
+        } else if (started == 1) {
+            // No worker could start: stop the reader and let it exit
+            atomic_store(&pipe.failed, 1);
+        }
+        for (int t = 0; t < started; t++) {
+            pthread_join(threads[t], NULL);
+        }
+
+        stats->seconds = dea_now() - start;
+        stats->workers = started > 0 ? started - 1 : 0;
+        if (stats->seconds > 0 && stats->workers > 0) {
+            stats->read_busy = pipe.read_busy / stats->seconds;
+            stats->write_busy = pipe.write_busy / stats->seconds;
+            double encrypt_total = 0;
+            for (int w = 0; w < stats->workers; w++) {
+                encrypt_total += pipe.encrypt_busy[w];
+            }
+            stats->encrypt_busy = encrypt_total / (stats->workers * stats->seconds);
+        }
+    }
+
+    free(pipe.free_ring.cells);
+    free(pipe.work_ring.cells);
+    free(pipe.done_ring.cells);
+    free(pipe.pending);
+    free(workers);
+    free(threads);
+    free(pipe.encrypt_busy);
+    free(arena);
+    free(pipe.blocks);
+
+    return started > 1 && !atomic_load(&pipe.failed);
+}
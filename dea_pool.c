@@ -0,0 +1,368 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE   // sched_getaffinity / CPU_COUNT
+#endif
+#include "dea.h"
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+// Below this many bytes per worker, waking threads costs more than it saves
+#define DEA_PARALLEL_MIN_BYTES (256 * 1024)
+
+struct DEA_Pool {
+    pthread_t *threads;        // Worker threads 1..num_threads-1 (the caller is worker 0)
+    int num_threads;
+    pthread_mutex_t lock;
+    pthread_cond_t start;      // Signalled when a new task is posted
+    pthread_cond_t done;       // Signalled when the last worker finishes
+    unsigned long generation;  // Incremented for every posted task
+    int pending;               // Workers still running the current task
+    int shutdown;
+    dea_task_fn fn;
+    void *arg;
+};
+
+typedef struct {
+    DEA_Pool *pool;
+    int id;
+} DEA_WorkerStart;
+
+#ifndef _WIN32
+// CPU limit imposed by the cgroup CPU quota (v2 cpu.max or v1 CFS quota),
+// rounded up. Returns 0 if there is no quota.
+static int dea_cgroup_cpu_limit(void) {
+    long long quota = -1, period = 0;
+    char text[64];
+
+    FILE *file = fopen("/sys/fs/cgroup/cpu.max", "r");
+    if (file) {
+        if (fscanf(file, "%63s %lld", text, &period) == 2 && strcmp(text, "max") != 0) {
+            quota = atoll(text);
+        }
+        fclose(file);
+    } else {
+        file = fopen("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", "r");
+        if (file) {
+            if (fscanf(file, "%lld", &quota) != 1) quota = -1;
+            fclose(file);
+        }
+        file = fopen("/sys/fs/cgroup/cpu/cpu.cfs_period_us", "r");
+        if (file) {
+            if (fscanf(file, "%lld", &period) != 1) period = 0;
+            fclose(file);
+        }
+    }
+
+    if (quota <= 0 || period <= 0) {
+        return 0;
+    }
+    return (int)((quota + period - 1) / period);
+}
+#endif
+
+// Number of threads worth running: the CPUs this process may run on,
+// capped by the cgroup CPU quota. DEA_THREADS=<n> overrides it.
+int dea_default_threads(void) {
+    const char *forced = getenv("DEA_THREADS");
+    if (forced && atoi(forced) > 0) {
+        return atoi(forced);
+    }
+
+    int cpus = 1;
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    cpus = (int)info.dwNumberOfProcessors;
+#else
+#ifdef __linux__
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        cpus = CPU_COUNT(&set);
+    } else
+#endif
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        cpus = online > 0 ? (int)online : 1;
+    }
+
+    int limit = dea_cgroup_cpu_limit();
+    if (limit > 0 && limit < cpus) {
+        cpus = limit;
+    }
+#endif
+    return cpus > 0 ? cpus : 1;
+}
+
+static void *dea_worker_main(void *arg) {
+    DEA_WorkerStart *start = (DEA_WorkerStart*)arg;
+    DEA_Pool *pool = start->pool;
+    int id = start->id;
+    free(start);
+
+    unsigned long seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->shutdown && pool->generation == seen) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->shutdown) {
+            break;
+        }
+        seen = pool->generation;
+        dea_task_fn fn = pool->fn;
+        void *task_arg = pool->arg;
+        pthread_mutex_unlock(&pool->lock);
+
+        fn(task_arg, id, pool->num_threads);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+// Create a pool of `num_threads` workers including the calling thread
+// (0 = dea_default_threads()). The threads are started once and reused by
+// every dea_pool_run call. Returns NULL on failure.
+DEA_Pool *dea_pool_create(int num_threads) {
+    if (num_threads <= 0) {
+        num_threads = dea_default_threads();
+    }
+
+    DEA_Pool *pool = (DEA_Pool*)calloc(1, sizeof(DEA_Pool));
+    if (!pool) {
+        return NULL;
+    }
+    pool->num_threads = num_threads;
+    pool->threads = (pthread_t*)calloc((size_t)num_threads, sizeof(pthread_t));
+    if (!pool->threads) {
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (int i = 1; i < num_threads; i++) {
+        DEA_WorkerStart *start = (DEA_WorkerStart*)malloc(sizeof(DEA_WorkerStart));
+        if (start) {
+            start->pool = pool;
+            start->id = i;
+        }
+        if (!start || pthread_create(&pool->threads[i], NULL, dea_worker_main, start) != 0) {
+            free(start);
+            // Run with the workers that did start
+            pool->num_threads = i;
+            break;
+        }
+    }
+
+    return pool;
+}
+
+void dea_pool_destroy(DEA_Pool *pool) {
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 1; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->start);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool);
+}
+
+int dea_pool_threads(const DEA_Pool *pool) {
+    return pool ? pool->num_threads : 1;
+}
+
+// Run fn(arg, worker, num_workers) once on every worker, with the calling
+// thread acting as worker 0, and wait until all of them return. Only one
+// thread may post work to a pool at a time.
+void dea_pool_run(DEA_Pool *pool, dea_task_fn fn, void *arg) {
+    if (!pool || pool->num_threads == 1) {
+        fn(arg, 0, 1);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->arg = arg;
+    pool->pending = pool->num_threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    fn(arg, 0, pool->num_threads);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+typedef struct {
+    const DEA_Plan *plan;
+    uint64_t offset;
+    const uint8_t *data;
+    uint8_t *output;
+    size_t length;
+    size_t *bounds;            // Chunk boundaries from dea_partition
+    int parts;                 // Workers that have a share
+    int mode;                  // DEA_JOB_CRYPT, DEA_JOB_VERIFY or DEA_JOB_DIGEST
+    int store_mode;            // Store policy resolved for the whole buffer (crypt only)
+    size_t *mismatch;          // Per-worker first mismatch index (verify/digest)
+    DEA_Digest *digests;       // Per-worker digests (digest only)
+} DEA_ParallelJob;
+
+enum { DEA_JOB_CRYPT, DEA_JOB_VERIFY, DEA_JOB_DIGEST };
+
+static void dea_parallel_task(void *arg, int worker, int num_workers) {
+    DEA_ParallelJob *job = (DEA_ParallelJob*)arg;
+    (void)num_workers;
+    if (worker >= job->parts) {
+        return;
+    }
+
+    size_t begin = job->bounds[worker];
+    size_t end = job->bounds[worker + 1];
+    if (job->mode == DEA_JOB_CRYPT) {
+        dea_crypt_at_store(job->plan, job->offset + begin, job->data + begin, end - begin,
+                           job->output + begin, job->store_mode);
+        return;
+    }
+
+    size_t bad;
+    if (job->mode == DEA_JOB_DIGEST) {
+        dea_digest_init(&job->digests[worker]);
+        bad = dea_encrypt_digest(job->plan, job->offset + begin, job->data + begin,
+                                 end - begin, job->output + begin, &job->digests[worker]);
+    } else {
+        bad = dea_encrypt_verified(job->plan, job->offset + begin, job->data + begin,
+                                   end - begin, job->output + begin);
+    }
+    job->mismatch[worker] = bad == end - begin ? job->length : begin + bad;
+}
+
+// Partition a job across the pool and run it. Returns 0 without doing any
+// work if the buffer is too small to split (or on allocation failure), in
+// which case the caller runs it on the calling thread.
+static int dea_parallel_dispatch(DEA_Pool *pool, DEA_ParallelJob *job) {
+    int parts = dea_pool_threads(pool);
+    size_t max_parts = job->length / DEA_PARALLEL_MIN_BYTES;
+    if ((size_t)parts > max_parts) {
+        parts = max_parts > 0 ? (int)max_parts : 1;
+    }
+    if (parts == 1) {
+        return 0;
+    }
+
+    // One allocation for the boundaries and the per-worker results
+    size_t *bounds = (size_t*)malloc(((size_t)parts * 2 + 1) * sizeof(size_t));
+    if (!bounds) {
+        return 0;
+    }
+    if (job->mode == DEA_JOB_DIGEST) {
+        job->digests = (DEA_Digest*)malloc((size_t)parts * sizeof(DEA_Digest));
+        if (!job->digests) {
+            free(bounds);
+            return 0;
+        }
+    }
+
+    // Partition relative to the output address so chunk starts are cache-line
+    // aligned; the leading piece before the first aligned address goes to worker 0.
+    // Chunks then start at key phase (offset + lead) % period, not 0, which the
+    // workers handle by deriving their phase from the absolute offset.
+    size_t lead = (DEA_CACHE_LINE - ((uintptr_t)job->output & (DEA_CACHE_LINE - 1))) & (DEA_CACHE_LINE - 1);
+    dea_partition(job->length - lead, parts, job->plan->num_keys, DEA_CACHE_LINE, bounds);
+    for (int i = 1; i <= parts; i++) {
+        bounds[i] += lead;
+    }
+
+    job->bounds = bounds;
+    job->mismatch = bounds + parts + 1;
+    job->parts = parts;
+    dea_pool_run(pool, dea_parallel_task, job);
+    return 1;
+}
+
+// Encrypt or decrypt `length` bytes at stream `offset` using every worker of
+// the pool. Each worker handles one contiguous range from dea_partition,
+// aligned to the cache lines of `output` so workers never share a cache
+// line of output. Unless `output` is itself aligned, a range may start in
+// the middle of a key period; every worker recomputes its key phase from
+// the range's absolute offset.
+// Whether to use non-temporal stores is decided on the whole buffer, since
+// the workers share the last-level cache. A NULL pool runs on the calling
+// thread. `data` and `output` may be the same buffer.
+void dea_encrypt_parallel(DEA_Pool *pool, const DEA_Plan *plan, uint64_t offset,
+                          const uint8_t *data, size_t length, uint8_t *output) {
+    int store_mode = length >= dea_streaming_threshold() ? DEA_STORE_STREAMING : DEA_STORE_CACHED;
+    DEA_ParallelJob job = { plan, offset, data, output, length, NULL, 0, DEA_JOB_CRYPT, store_mode, NULL, NULL };
+    if (!dea_parallel_dispatch(pool, &job)) {
+        dea_crypt_at(plan, offset, data, length, output);
+        return;
+    }
+    free(job.bounds);
+}
+
+// Multi-threaded dea_encrypt_verified. Returns the index of the first byte
+// that does not round-trip, or `length` if every byte verified.
+size_t dea_encrypt_verified_parallel(DEA_Pool *pool, const DEA_Plan *plan, uint64_t offset,
+                                     const uint8_t *data, size_t length, uint8_t *output) {
+    DEA_ParallelJob job = { plan, offset, data, output, length, NULL, 0, DEA_JOB_VERIFY, DEA_STORE_CACHED, NULL, NULL };
+    if (!dea_parallel_dispatch(pool, &job)) {
+        return dea_encrypt_verified(plan, offset, data, length, output);
+    }
+
+    size_t first = length;
+    for (int i = 0; i < job.parts; i++) {
+        if (job.mismatch[i] < first) {
+            first = job.mismatch[i];
+        }
+    }
+    free(job.bounds);
+    return first;
+}
+
+// Multi-threaded dea_encrypt_digest. Each worker digests its own range and
+// the per-worker digests are merged in order, so `digest` ends up identical
+// to a single-threaded run. Returns the first mismatch index, or `length`.
+size_t dea_encrypt_digest_parallel(DEA_Pool *pool, const DEA_Plan *plan, uint64_t offset,
+                                   const uint8_t *data, size_t length, uint8_t *output, DEA_Digest *digest) {
+    DEA_ParallelJob job = { plan, offset, data, output, length, NULL, 0, DEA_JOB_DIGEST, DEA_STORE_CACHED, NULL, NULL };
+    if (!dea_parallel_dispatch(pool, &job)) {
+        return dea_encrypt_digest(plan, offset, data, length, output, digest);
+    }
+
+    size_t first = length;
+    for (int i = 0; i < job.parts; i++) {
+        if (job.mismatch[i] < first) {
+            first = job.mismatch[i];
+        }
+        dea_digest_merge(digest, &job.digests[i]);
+    }
+    free(job.digests);
+    free(job.bounds);
+    return first;
+}
@@ -80,6 +80,24 @@ char* load_file(const char* filename, size_t* file_size) {
     return buffer;
 }
 
+// Bytes formatted per fwrite by append_ascii
+#define ASCII_BLOCK 16384
+
+// Append data as ASCII decimal values to an open file. Blocks of bytes are
+// formatted with the lookup table of dea_format_decimal and written with
+// one fwrite each, instead of one fprintf per byte.
+int append_ascii(FILE* file, const uint8_t* bytes, size_t size) {
+    char text[ASCII_BLOCK * DEA_DECIMAL_MAX_CHARS];
+    for (size_t i = 0; i < size; i += ASCII_BLOCK) {
+        size_t count = size - i < ASCII_BLOCK ? size - i : ASCII_BLOCK;
+        size_t length = dea_format_decimal(bytes + i, count, text);
+        if (fwrite(text, 1, length, file) != length) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
 int write_file_as_ascii(const char* filename, const void* data, size_t size) {
     FILE* file = fopen(filename, "w"); // Note: changed to "w" instead of "wb"
     if (!file) {
@@ -87,16 +105,72 @@ int write_file_as_ascii(const char* filename, const void* data, size_t size) {
         return 0;
     }
     
-    const uint8_t* bytes = (const uint8_t*)data;
-    for (size_t i = 0; i < size; i++) {
-        // Write each byte as an ASCII decimal value followed by a space
-        fprintf(file, "%d ", bytes[i]);
-    }
+    append_ascii(file, (const uint8_t*)data, size);
     
     fclose(file);
     return 1;
 }
 
+// Bytes each rank formats per collective write in write_ascii_at_all
+#define ASCII_WRITE_BLOCK (1 << 20)
+
+// Collectively write the ciphertext as ASCII decimal values, each rank of
+// `comm` passing its own chunk (chunks are in rank order in the stream). The text
+// length of a chunk is known without formatting it, so an exclusive prefix
+// sum of the lengths gives every rank its offset in the file. All ranks then
+// format and write their text in parallel through MPI-IO instead of rank 0
+// formatting the whole file. Returns 1 only if every rank succeeded.
+int write_ascii_at_all(MPI_Comm comm, const char* filename, const uint8_t* chunk, size_t size) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    
+    unsigned long long length = dea_decimal_length(chunk, size), offset = 0, total = 0;
+    MPI_Exscan(&length, &offset, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, comm);
+    if (rank == 0) {
+        offset = 0;   // MPI_Exscan leaves rank 0's result undefined
+    }
+    MPI_Allreduce(&length, &total, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, comm);
+    
+    // Collective writes must be matched on every rank, so all ranks make as
+    // many rounds as the largest chunk needs (writing 0 bytes when done)
+    unsigned long long blocks = (size + ASCII_WRITE_BLOCK - 1) / ASCII_WRITE_BLOCK, rounds = 0;
+    MPI_Allreduce(&blocks, &rounds, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX, comm);
+    
+    MPI_File fh;
+    if (MPI_File_open(comm, (char*)filename, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                      MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        if (rank == 0) {
+            printf("Error: Could not open file %s for writing\n", filename);
+        }
+        return 0;
+    }
+    
+    // Cut off what a longer earlier output left behind
+    int ok = MPI_File_set_size(fh, (MPI_Offset)total) == MPI_SUCCESS;
+    char* text = malloc(ASCII_WRITE_BLOCK * DEA_DECIMAL_MAX_CHARS);
+    if (!text) {
+        ok = 0;
+    }
+    for (unsigned long long r = 0; r < rounds; r++) {
+        size_t start = (size_t)r * ASCII_WRITE_BLOCK;
+        size_t count = start < size ? size - start : 0;
+        if (count > ASCII_WRITE_BLOCK) count = ASCII_WRITE_BLOCK;
+        int chars = text && count > 0 ? (int)dea_format_decimal(chunk + start, count, text) : 0;
+        if (MPI_File_write_at_all(fh, (MPI_Offset)offset, text, chars, MPI_CHAR, MPI_STATUS_IGNORE) != MPI_SUCCESS) {
+            ok = 0;
+        }
+        offset += chars;
+    }
+    if (MPI_File_close(&fh) != MPI_SUCCESS) {
+        ok = 0;
+    }
+    free(text);
+    
+    int all_ok = 0;
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_MIN, comm);
+    return all_ok;
+}
+
 // Function to write data to a file
 int write_file(const char* filename, const void* data, size_t size) {
     FILE* file = fopen(filename, "wb");
@@ -116,18 +190,1019 @@ int write_file(const char* filename, const void* data, size_t size) {
     return 1;
 }
 
+// MPI counts are ints, so larger messages are split into pieces of this size
+#define MAX_MESSAGE_BYTES (1 << 30)
+#define LINES_PER_ROUND (MAX_MESSAGE_BYTES / DEA_CACHE_LINE)
+
+// Scatter (gather = 0) or gather (gather = 1) every rank's chunk
+// [bounds[i], bounds[i + 1]) of the master's `data` to or from `chunk`
+// (collective over `comm`, whose rank 0 is the master). The master's own chunk stays in place at the start of
+// `data`. MPI_Scatterv/MPI_Gatherv let the library use tree or pipelined
+// algorithms instead of one blocking send per rank. Their counts and
+// displacements are ints, so whole cache lines are moved as one datatype
+// (every chunk boundary but the end of the data is a multiple of
+// DEA_CACHE_LINE; displacements then reach 128 GB) in rounds of at most
+// MAX_MESSAGE_BYTES per rank, and the last rank's partial line follows in a
+// byte-sized call. `chunk` is not used on the master.
+void exchange_chunks(MPI_Comm comm, uint8_t *data, const size_t *bounds, int rank, int size, uint8_t *chunk, int gather) {
+    if (size == 1) {
+        return;
+    }
+    int *counts = malloc(size * sizeof(int));
+    int *displs = malloc(size * sizeof(int));
+    if (!counts || !displs) {
+        printf("Process %d: Memory allocation failed\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Datatype line;
+    MPI_Type_contiguous(DEA_CACHE_LINE, MPI_BYTE, &line);
+    MPI_Type_commit(&line);
+    
+    size_t max_lines = 0;
+    for (int i = 0; i < size; i++) {
+        size_t lines = (bounds[i + 1] - bounds[i]) / DEA_CACHE_LINE;
+        if (lines > max_lines) max_lines = lines;
+    }
+    for (size_t done = 0; done < max_lines; done += LINES_PER_ROUND) {
+        for (int i = 0; i < size; i++) {
+            size_t lines = (bounds[i + 1] - bounds[i]) / DEA_CACHE_LINE;
+            size_t left = lines > done ? lines - done : 0;
+            counts[i] = (int)(left < LINES_PER_ROUND ? left : LINES_PER_ROUND);
+            displs[i] = (int)(bounds[i] / DEA_CACHE_LINE + done);
+        }
+        void *mine = rank == 0 ? MPI_IN_PLACE : chunk + done * DEA_CACHE_LINE;
+        if (gather) {
+            MPI_Gatherv(mine, counts[rank], line, data, counts, displs, line, 0, comm);
+        } else {
+            MPI_Scatterv(data, counts, displs, line, mine, counts[rank], line, 0, comm);
+        }
+    }
+    
+    // The bytes after the last whole line of the last rank's chunk
+    size_t tail = (bounds[size] - bounds[size - 1]) % DEA_CACHE_LINE;
+    if (tail > 0) {
+        size_t tail_start = bounds[size] - tail;
+        for (int i = 0; i < size; i++) {
+            counts[i] = i == size - 1 ? (int)tail : 0;
+            displs[i] = 0;
+        }
+        uint8_t *root_tail = rank == 0 ? data + tail_start : NULL;
+        void *mine = rank == 0 ? MPI_IN_PLACE : rank == size - 1 ? chunk + (tail_start - bounds[rank]) : chunk;
+        if (gather) {
+            MPI_Gatherv(mine, counts[rank], MPI_BYTE, root_tail, counts, displs, MPI_BYTE, 0, comm);
+        } else {
+            MPI_Scatterv(root_tail, counts, displs, MPI_BYTE, mine, counts[rank], MPI_BYTE, 0, comm);
+        }
+    }
+    
+    MPI_Type_free(&line);
+    free(counts);
+    free(displs);
+}
+
+// Chunk boundaries for every rank of `comm` (collective). Chunks are multiples of
+// lcm(num_keys, cache line), so every rank starts at key phase 0 on an
+// aligned offset, and are sized in proportion to each rank's DEA_WEIGHT
+// (default 1) for clusters with nodes of different speeds. Rank i gets
+// [bounds[i], bounds[i + 1]); the caller frees the array.
+size_t* compute_chunk_bounds(MPI_Comm comm, size_t file_size, int rank, int size, int num_keys) {
+    size_t *bounds = malloc((size + 1) * sizeof(size_t));
+    if (!bounds) {
+        printf("Process %d: Memory allocation failed\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    
+    const char *weight_env = getenv("DEA_WEIGHT");
+    double weight = weight_env ? atof(weight_env) : 1.0;
+    if (weight <= 0.0) {
+        weight = 1.0;
+    }
+    
+    double *weights = rank == 0 ? malloc(size * sizeof(double)) : NULL;
+    MPI_Gather(&weight, 1, MPI_DOUBLE, weights, 1, MPI_DOUBLE, 0, comm);
+    if (rank == 0) {
+        dea_partition_weighted(file_size, size, num_keys, DEA_CACHE_LINE, weights, bounds);
+        free(weights);
+    }
+    MPI_Bcast(bounds, size + 1, MPI_UNSIGNED_LONG_LONG, 0, comm);
+    
+    return bounds;
+}
+
+// Read (writing = 0) or write `length` bytes at `offset` of an open MPI file
+// (collective). Counts are ints, so the transfer runs in rounds of at most
+// MAX_MESSAGE_BYTES; ranks with less data join the later rounds with 0
+// bytes. Returns 1 only if every rank succeeded.
+int file_at_all(MPI_File fh, MPI_Offset offset, uint8_t *data, size_t length, int writing) {
+    unsigned long long rounds = (length + MAX_MESSAGE_BYTES - 1) / MAX_MESSAGE_BYTES, max_rounds = 0;
+    MPI_Allreduce(&rounds, &max_rounds, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+    int ok = 1;
+    for (unsigned long long r = 0; r < max_rounds; r++) {
+        size_t done = (size_t)r * MAX_MESSAGE_BYTES;
+        int piece = done < length ? (int)(length - done < MAX_MESSAGE_BYTES ? length - done : MAX_MESSAGE_BYTES) : 0;
+        uint8_t *at = done < length ? data + done : data;
+        int err = writing ? MPI_File_write_at_all(fh, offset + (MPI_Offset)done, at, piece, MPI_BYTE, MPI_STATUS_IGNORE)
+                        : MPI_File_read_at_all(fh, offset + (MPI_Offset)done, at, piece, MPI_BYTE, MPI_STATUS_IGNORE);
+        if (err != MPI_SUCCESS) {
+            ok = 0;
+        }
+    }
+    int all_ok = 0;
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    return all_ok;
+}
+
+// Thread team for this rank's encryption (hybrid MPI + threads). A positive
+// `threads` is taken as given; 0 divides the CPUs this rank may run on
+// among the ranks of its node (MPI_COMM_TYPE_SHARED), so one unbound rank
+// per node gets every core and 16 unbound ranks on 16 cores get one each.
+// Only the main thread makes MPI calls, which MPI_THREAD_FUNNELED allows.
+// Returns NULL (encrypt on the calling thread) for a single thread.
+DEA_Pool *create_rank_pool(int threads, int rank) {
+    if (threads <= 0) {
+        MPI_Comm node;
+        int node_ranks = 1;
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node);
+        MPI_Comm_size(node, &node_ranks);
+        MPI_Comm_free(&node);
+        threads = dea_default_threads() / node_ranks;
+    }
+    if (threads <= 1) {
+        return NULL;
+    }
+    DEA_Pool *pool = dea_pool_create(threads);
+    if (!pool) {
+        printf("Process %d: Could not start %d threads, encrypting on one\n", rank, threads);
+    }
+    return pool;
+}
+
+// Command-line options (parsed identically on every rank)
+typedef struct {
+    int in_place;    // Master encrypts and decrypts in the input buffer (one full-size buffer)
+    int full_verify; // Verify with a separate decryption pass instead of the fused kernel
+    int checksum;    // Report CRC32C digests of the plaintext and ciphertext
+    int mmap_io;     // Master maps the input and the decrypted output file instead of read/write
+    size_t stream_window; // Stream the file through windows of this many bytes (0 = load it whole)
+    size_t sub_block;     // With streaming: move pieces in sub-blocks of this many bytes, non-blocking (0 = collectives)
+    int mpi_io;      // Every rank reads and writes its own slice of the files with MPI-IO
+    int threads;     // Encryption threads per rank (1 = none, 0 = the node's CPUs shared among its ranks)
+    int shared;      // Ranks of a node encrypt in place in an MPI shared-memory window
+} Options;
+
+void print_usage(const char *program) {
+    printf("Usage: mpirun -np <N> %s [--in-place] [--full-verify] [--checksum] [--mmap] [--stream MB] [--pipeline KB] [--mpi-io] [--threads N] [--shared]\n", program);
+    printf("  --in-place     Master encrypts and decrypts in the input buffer\n");
+    printf("  --full-verify  Verify with a separate decryption pass and compare on the master\n");
+    printf("                 (default: every rank checks the round trip inside its encryption pass)\n");
+    printf("  --checksum     Every rank digests its chunk (CRC32C) during encryption and the\n");
+    printf("                 master merges them into whole-file digests\n");
+    printf("  --mmap         Master maps the input and output files (no heap copies)\n");
+    printf("  --stream MB    Master reads the file in MB-sized windows and splits each across the\n");
+    printf("                 ranks (constant memory, one pass)\n");
+    printf("  --pipeline KB  --stream with every rank's piece moved in KB-sized sub-blocks through\n");
+    printf("                 non-blocking sends and receives, overlapping transfer and encryption\n");
+    printf("  --mpi-io       Every rank reads its slice of the input and writes its slices of both\n");
+    printf("                 outputs with collective MPI-IO (no data passes through the master)\n");
+    printf("  --threads N    Encrypt every rank's chunk with a team of N threads (0 = the node's CPUs\n");
+    printf("                 divided by its ranks); run one rank per node or socket with this\n");
+    printf("  --shared       Ranks of a node share one MPI shared-memory window: only node leaders\n");
+    printf("                 receive data, the other ranks encrypt their slices there in place\n");
+}
+
+// Parse command-line options. Returns 0 on an unknown option.
+int parse_options(int argc, char *argv[], int rank, Options *opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->threads = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--in-place") == 0) {
+            opts->in_place = 1;
+        } else if (strcmp(argv[i], "--full-verify") == 0) {
+            opts->full_verify = 1;
+        } else if (strcmp(argv[i], "--checksum") == 0) {
+            opts->checksum = 1;
+        } else if (strcmp(argv[i], "--mmap") == 0) {
+            opts->mmap_io = 1;
+        } else if (strcmp(argv[i], "--stream") == 0 && i + 1 < argc) {
+            int mb = atoi(argv[++i]);
+            opts->stream_window = (size_t)(mb > 0 ? mb : 16) * 1024 * 1024;
+        } else if (strcmp(argv[i], "--pipeline") == 0 && i + 1 < argc) {
+            int kb = atoi(argv[++i]);
+            opts->sub_block = (size_t)(kb > 0 ? kb : 256) * 1024;
+            // Sub-blocks go through MPI_Isend/MPI_Irecv with an int count
+            if (opts->sub_block > MAX_MESSAGE_BYTES) {
+                opts->sub_block = MAX_MESSAGE_BYTES;
+            }
+        } else if (strcmp(argv[i], "--mpi-io") == 0) {
+            opts->mpi_io = 1;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            opts->threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--shared") == 0) {
+            opts->shared = 1;
+        } else {
+            if (rank == 0) {
+                printf("Unknown option: %s\n", argv[i]);
+                print_usage(argv[0]);
+            }
+            return 0;
+        }
+    }
+    if (opts->sub_block && !opts->stream_window) {
+        opts->stream_window = (size_t)16 * 1024 * 1024;
+    }
+    return 1;
+}
+
+// Encrypt one rank's piece of a streamed window at its stream offset into
+// `output` (which may be `data`), extending `digest` (if --checksum) and
+// lowering `mismatch`. The rank's thread team (if any) shares the work.
+void encrypt_piece(DEA_Pool *pool, const Options *opts, const DEA_Plan *plan, uint64_t offset, const uint8_t *data,
+                   size_t length, uint8_t *output, DEA_Digest *digest, uint64_t *mismatch) {
+    size_t bad = length;
+    if (opts->checksum) {
+        bad = dea_encrypt_digest_parallel(pool, plan, offset, data, length, output, digest);
+    } else if (opts->full_verify) {
+        dea_encrypt_parallel(pool, plan, offset, data, length, output);
+    } else {
+        bad = dea_encrypt_verified_parallel(pool, plan, offset, data, length, output);
+    }
+    if (bad != length && offset + bad < *mismatch) {
+        *mismatch = offset + bad;
+    }
+}
+
+// Tags of the pipelined sub-block messages
+#define TAG_PLAIN 1
+#define TAG_CIPHER 2
+
+// Pipelined exchange of one streamed window, master side. Every worker's
+// piece is cut into sub-blocks. The receives for all returning ciphertext
+// sub-blocks are posted first, then the plaintext sub-blocks go out with
+// MPI_Isend, and the master encrypts its own piece into `cipher` one
+// sub-block at a time, testing the requests in between so the transfers
+// progress while it computes. Workers send each sub-block back as soon as
+// it is encrypted, so a window takes about max(transfer, compute) rather
+// than their sum.
+void pipeline_window_master(DEA_Pool *pool, const Options *opts, const DEA_Plan *plan, uint64_t offset,
+                            const uint8_t *window, uint8_t *cipher, const size_t *bounds, int size, DEA_Digest *digest, uint64_t *mismatch) {
+    size_t block = opts->sub_block;
+    size_t count = 0;
+    for (int i = 1; i < size; i++) {
+        count += (bounds[i + 1] - bounds[i] + block - 1) / block;
+    }
+    MPI_Request *requests = malloc((2 * count + 1) * sizeof(MPI_Request));
+    if (!requests) {
+        printf("Memory allocation failed\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+        return;
+    }
+    
+    int n = 0;
+    for (int i = 1; i < size; i++) {
+        for (size_t pos = bounds[i]; pos < bounds[i + 1]; pos += block) {
+            int piece = (int)(bounds[i + 1] - pos < block ? bounds[i + 1] - pos : block);
+            MPI_Irecv(cipher + pos, piece, MPI_BYTE, i, TAG_CIPHER, MPI_COMM_WORLD, &requests[n++]);
+        }
+    }
+    for (int i = 1; i < size; i++) {
+        for (size_t pos = bounds[i]; pos < bounds[i + 1]; pos += block) {
+            int piece = (int)(bounds[i + 1] - pos < block ? bounds[i + 1] - pos : block);
+            MPI_Isend((void*)(window + pos), piece, MPI_BYTE, i, TAG_PLAIN, MPI_COMM_WORLD, &requests[n++]);
+        }
+    }
+    
+    for (size_t pos = 0; pos < bounds[1]; pos += block) {
+        size_t piece = bounds[1] - pos < block ? bounds[1] - pos : block;
+        encrypt_piece(pool, opts, plan, offset + pos, window + pos, piece, cipher + pos, digest, mismatch);
+        int done;
+        MPI_Testall(n, requests, &done, MPI_STATUSES_IGNORE);
+    }
+    MPI_Waitall(n, requests, MPI_STATUSES_IGNORE);
+    free(requests);
+}
+
+// Pipelined exchange of one streamed window, worker side. Two sub-block
+// buffers: the receive of sub-block k + 1 is in flight while sub-block k
+// is encrypted, and every encrypted sub-block is sent back at once.
+void pipeline_window_worker(DEA_Pool *pool, const Options *opts, const DEA_Plan *plan, uint64_t offset,
+                            size_t length, uint8_t *buffers[2], DEA_Digest *digest, uint64_t *mismatch) {
+    size_t block = opts->sub_block;
+    size_t blocks = (length + block - 1) / block;
+    MPI_Request recv[2] = { MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+    MPI_Request send[2] = { MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+    if (blocks > 0) {
+        int first = (int)(length < block ? length : block);
+        MPI_Irecv(buffers[0], first, MPI_BYTE, 0, TAG_PLAIN, MPI_COMM_WORLD, &recv[0]);
+    }
+    for (size_t k = 0; k < blocks; k++) {
+        int slot = (int)(k & 1);
+        size_t pos = k * block;
+        size_t piece = length - pos < block ? length - pos : block;
+        MPI_Wait(&recv[slot], MPI_STATUS_IGNORE);
+        if (k + 1 < blocks) {
+            // The other buffer is reused once its last send has completed
+            size_t next = length - pos - piece < block ? length - pos - piece : block;
+            MPI_Wait(&send[!slot], MPI_STATUS_IGNORE);
+            MPI_Irecv(buffers[!slot], (int)next, MPI_BYTE, 0, TAG_PLAIN, MPI_COMM_WORLD, &recv[!slot]);
+        }
+        encrypt_piece(pool, opts, plan, offset + pos, buffers[slot], piece, buffers[slot], digest, mismatch);
+        MPI_Isend(buffers[slot], (int)piece, MPI_BYTE, 0, TAG_CIPHER, MPI_COMM_WORLD, &send[slot]);
+    }
+    MPI_Waitall(2, send, MPI_STATUSES_IGNORE);
+}
+
+// Streaming mode, master side. The master reads the file through two
+// window buffers (the next window is read in the background), splits each
+// window across the ranks like a whole file (with collectives, or with
+// pipelined sub-blocks under --pipeline), gathers the ciphertext back,
+// appends it to the ASCII output, decrypts it in place with a cursor that
+// carries the key phase across windows and appends it to the decrypted
+// output. Memory use is constant on every rank whatever the file size.
+// Returns the process exit code.
+int run_streaming_master(DEA_Pool *pool, const Options *opts, const DEA_Plan *plan, int size,
+                         const char *input_file, const char *encrypted_file, const char *decrypted_file) {
+    uint64_t header[2] = { 0, 0 };   // Window offset and length; length 0 ends the stream
+    printf("Streaming window: %zu MB (double buffered)\n", opts->stream_window / (1024 * 1024));
+    if (opts->sub_block) {
+        printf("Pipelined sub-blocks: %zu KB (non-blocking, double buffered on the workers)\n", opts->sub_block / 1024);
+    }
+    
+    DEA_Stream *stream = dea_stream_open(input_file, opts->stream_window);
+    FILE *encrypted_out = fopen(encrypted_file, "w");
+    FILE *decrypted_out = fopen(decrypted_file, "wb");
+    if (!stream || !encrypted_out || !decrypted_out) {
+        // An empty window releases the workers, which then join the final reduction
+        printf("Error: Could not open %s or the output files\n", input_file);
+        uint64_t unused = UINT64_MAX, result;
+        MPI_Bcast(header, 2, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&unused, &result, 1, MPI_UNSIGNED_LONG_LONG, MPI_MIN, 0, MPI_COMM_WORLD);
+        if (encrypted_out) fclose(encrypted_out);
+        if (decrypted_out) fclose(decrypted_out);
+        dea_stream_close(stream);
+        return 1;
+    }
+    
+    uint64_t read_cycles = 0, encrypt_cycles = 0, decrypt_cycles = 0, write_cycles = 0;
+    uint64_t start_cycles, end_cycles;
+    uint64_t mismatch = UINT64_MAX;
+    uint32_t plain_crc = 0, decrypted_crc = 0;
+    int write_success = 1;
+    DEA_Digest digest;
+    dea_digest_init(&digest);
+    DEA_Digest *worker_digests = malloc(size * sizeof(DEA_Digest));
+    // Pipelined sub-blocks return into a separate window: the plaintext
+    // window is still being sent from while ciphertext arrives
+    uint8_t *cipher_window = opts->sub_block ? malloc(opts->stream_window) : NULL;
+    if (!worker_digests || (opts->sub_block && !cipher_window)) {
+        printf("Memory allocation failed\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+        return 1;
+    }
+    
+    DEA_Cursor cursor;
+    dea_cursor_init(&cursor, plan, 0);
+    
+    uint8_t *window;
+    uint64_t offset;
+    size_t length;
+    for (;;) {
+        start_cycles = get_cycles();
+        length = dea_stream_next(stream, &window, &offset);
+        end_cycles = get_cycles();
+        read_cycles += end_cycles - start_cycles;
+        
+        header[0] = offset;
+        header[1] = length;
+        MPI_Bcast(header, 2, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+        if (length == 0) {
+            break;
+        }
+        if (offset == 0) {
+            print_data("Original (sample)", window, length);
+        }
+        
+        // Split the window across the ranks; the master keeps the first piece
+        start_cycles = get_cycles();
+        if (opts->full_verify) {
+            plain_crc = dea_crc32c(plain_crc, window, length);
+        }
+        size_t *bounds = compute_chunk_bounds(MPI_COMM_WORLD, length, 0, size, plan->num_keys);
+        if (opts->sub_block) {
+            pipeline_window_master(pool, opts, plan, offset, window, cipher_window, bounds, size, &digest, &mismatch);
+            window = cipher_window;
+        } else {
+            exchange_chunks(MPI_COMM_WORLD, window, bounds, 0, size, NULL, 0);
+            encrypt_piece(pool, opts, plan, offset, window, bounds[1], window, &digest, &mismatch);
+            exchange_chunks(MPI_COMM_WORLD, window, bounds, 0, size, NULL, 1);
+        }
+        if (opts->checksum) {
+            // Merged in rank order, which is stream order
+            MPI_Gather(&digest, sizeof(DEA_Digest), MPI_BYTE, worker_digests, sizeof(DEA_Digest), MPI_BYTE,
+                       0, MPI_COMM_WORLD);
+            for (int i = 1; i < size; i++) {
+                dea_digest_merge(&digest, &worker_digests[i]);
+            }
+        }
+        free(bounds);
+        end_cycles = get_cycles();
+        encrypt_cycles += end_cycles - start_cycles;
+        
+        start_cycles = get_cycles();
+        if (!append_ascii(encrypted_out, window, length)) {
+            write_success = 0;
+        }
+        end_cycles = get_cycles();
+        write_cycles += end_cycles - start_cycles;
+        
+        start_cycles = get_cycles();
+        dea_cursor_crypt(&cursor, window, length, window);
+        if (opts->full_verify) {
+            decrypted_crc = dea_crc32c(decrypted_crc, window, length);
+        }
+        end_cycles = get_cycles();
+        decrypt_cycles += end_cycles - start_cycles;
+        
+        start_cycles = get_cycles();
+        if (fwrite(window, 1, length, decrypted_out) != length) {
+            write_success = 0;
+        }
+        end_cycles = get_cycles();
+        write_cycles += end_cycles - start_cycles;
+    }
+    
+    // First mismatching stream offset found by any rank's fused check
+    uint64_t first_mismatch = mismatch;
+    MPI_Reduce(&mismatch, &first_mismatch, 1, MPI_UNSIGNED_LONG_LONG, MPI_MIN, 0, MPI_COMM_WORLD);
+    
+    size_t file_size = (size_t)cursor.offset;
+    int read_error = dea_stream_error(stream);
+    dea_stream_close(stream);
+    free(worker_digests);
+    free(cipher_window);
+    if (fclose(encrypted_out) != 0 || fclose(decrypted_out) != 0) {
+        write_success = 0;
+    }
+    
+    printf("Streamed %zu bytes\n", file_size);
+    if (read_error) {
+        printf("Error: Read failed after %zu bytes\n", file_size);
+    }
+    printf(write_success ? "Encrypted data (as ASCII numbers) written to %s\n"
+                         : "Failed to write encrypted data to %s\n", encrypted_file);
+    printf(write_success ? "Decrypted data written to %s\n"
+                         : "Failed to write decrypted data to %s\n", decrypted_file);
+    if (opts->checksum) {
+        printf("Plaintext CRC32C:  %08X (%llu bytes)\n", digest.plain_crc, (unsigned long long)digest.length);
+        printf("Ciphertext CRC32C: %08X\n", digest.cipher_crc);
+    }
+    
+    int verified = first_mismatch == UINT64_MAX && !read_error;
+    if (opts->full_verify && plain_crc != decrypted_crc) {
+        verified = 0;
+    }
+    if (verified) {
+        printf("\nVerification SUCCESSFUL - The decrypted text matches the original!\n");
+    } else {
+        printf("\nVerification FAILED - The decrypted text does not match the original!\n");
+        if (first_mismatch != UINT64_MAX) {
+            printf("First mismatch at byte %llu\n", (unsigned long long)first_mismatch);
+        }
+    }
+    
+    uint64_t total_cycles = read_cycles + encrypt_cycles + decrypt_cycles + write_cycles;
+    if (file_size == 0 || total_cycles == 0) {
+        return verified ? 0 : 1;
+    }
+    printf("\n=== Performance Results (%zuMB file, %d processes, streamed once) ===\n",
+           (file_size / (1024 * 1024)) + ((file_size % (1024 * 1024)) ? 1 : 0), size);
+    printf("Read wait:     %llu cycles (%.3f ms) (%.3f%% of total)\n",
+           (unsigned long long)read_cycles, cycles_to_ms(read_cycles), (double)read_cycles / total_cycles * 100.0);
+    printf("Encryption:    %llu cycles (%.3f ms) (%.3f%% of total)\n",
+           (unsigned long long)encrypt_cycles, cycles_to_ms(encrypt_cycles), (double)encrypt_cycles / total_cycles * 100.0);
+    printf("Decryption:    %llu cycles (%.3f ms) (%.3f%% of total)\n",
+           (unsigned long long)decrypt_cycles, cycles_to_ms(decrypt_cycles), (double)decrypt_cycles / total_cycles * 100.0);
+    printf("File write:    %llu cycles (%.3f ms) (%.3f%% of total)\n",
+           (unsigned long long)write_cycles, cycles_to_ms(write_cycles), (double)write_cycles / total_cycles * 100.0);
+    printf("Total:         %llu cycles (%.3f ms)\n",
+           (unsigned long long)total_cycles, cycles_to_ms(total_cycles));
+    
+    printf("\nCycles per byte:\n");
+    printf("Read wait:   %.2f cycles/byte\n", (double)read_cycles / file_size);
+    printf("Encryption:  %.2f cycles/byte\n", (double)encrypt_cycles / file_size);
+    printf("Decryption:  %.2f cycles/byte\n", (double)decrypt_cycles / file_size);
+    printf("File write:  %.2f cycles/byte\n", (double)write_cycles / file_size);
+    printf("Total:       %.2f cycles/byte\n", (double)total_cycles / file_size);
+    return verified ? 0 : 1;
+}
+
+// Streaming mode, worker side: encrypt this rank's piece of every window
+// until the master broadcasts an empty window
+void run_streaming_worker(DEA_Pool *pool, const Options *opts, const DEA_Plan *plan, int rank, int size) {
+    // Pipelined pieces only ever need two sub-blocks in memory
+    uint8_t *piece = malloc(opts->sub_block ? 2 * opts->sub_block : opts->stream_window);
+    uint8_t *buffers[2] = { piece, piece + opts->sub_block };
+    if (!piece) {
+        printf("Worker %d: Memory allocation failed\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+        return;
+    }
+    
+    uint64_t mismatch = UINT64_MAX;
+    uint64_t header[2];
+    for (;;) {
+        MPI_Bcast(header, 2, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+        if (header[1] == 0) {
+            break;
+        }
+        
+        size_t *bounds = compute_chunk_bounds(MPI_COMM_WORLD, (size_t)header[1], rank, size, plan->num_keys);
+        size_t length = bounds[rank + 1] - bounds[rank];
+        uint64_t offset = header[0] + bounds[rank];
+        
+        DEA_Digest digest;
+        dea_digest_init(&digest);
+        if (opts->sub_block) {
+            pipeline_window_worker(pool, opts, plan, offset, length, buffers, &digest, &mismatch);
+        } else {
+            exchange_chunks(MPI_COMM_WORLD, NULL, bounds, rank, size, piece, 0);
+            encrypt_piece(pool, opts, plan, offset, piece, length, piece, &digest, &mismatch);
+            exchange_chunks(MPI_COMM_WORLD, NULL, bounds, rank, size, piece, 1);
+        }
+        if (opts->checksum) {
+            MPI_Gather(&digest, sizeof(DEA_Digest), MPI_BYTE, NULL, sizeof(DEA_Digest), MPI_BYTE, 0, MPI_COMM_WORLD);
+        }
+        free(bounds);
+    }
+    
+    MPI_Reduce(&mismatch, NULL, 1, MPI_UNSIGNED_LONG_LONG, MPI_MIN, 0, MPI_COMM_WORLD);
+    free(piece);
+}
+
+// MPI-IO mode: every rank opens the files itself, reads its slice of the
+// input with MPI_File_read_at_all at the slice's stream offset (which also
+// fixes its key phase), encrypts it, and writes its slices of the ASCII
+// ciphertext and of the decrypted output with MPI_File_write_at_all. No file
+// data passes through the master, so I/O bandwidth adds up across ranks
+// instead of being bound by rank 0's disk and network link. Returns the
+// process exit code (meaningful on the master).
+int run_mpi_io(DEA_Pool *pool, const Options *opts, const DEA_Plan *plan, int rank, int size,
+               int num_iterations, const char *input_file, const char *encrypted_file, const char *decrypted_file) {
+    enum { READ, ENCRYPT, DECRYPT, WRITE, PHASES };
+    uint64_t cycles[PHASES] = { 0, 0, 0, 0 }, slowest[PHASES];
+    uint64_t start_cycles = get_cycles();
+    
+    MPI_File fh;
+    if (MPI_File_open(MPI_COMM_WORLD, (char*)input_file, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        if (rank == 0) {
+            printf("Error: Could not open file %s\n", input_file);
+        }
+        return 1;
+    }
+    MPI_Offset total_size = 0;
+    MPI_File_get_size(fh, &total_size);
+    size_t file_size = (size_t)total_size;
+    size_t *bounds = compute_chunk_bounds(MPI_COMM_WORLD, file_size, rank, size, plan->num_keys);
+    size_t offset = bounds[rank];
+    size_t length = bounds[rank + 1] - bounds[rank];
+    
+    uint8_t *plain = malloc(length > 0 ? length : 1);
+    uint8_t *cipher = malloc(length > 0 ? length : 1);
+    if (!plain || !cipher) {
+        printf("Process %d: Memory allocation failed\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+        return 1;
+    }
+    int read_ok = file_at_all(fh, (MPI_Offset)offset, plain, length, 0);
+    MPI_File_close(&fh);
+    cycles[READ] = get_cycles() - start_cycles;
+    if (rank == 0) {
+        printf("File size: %zu bytes, %d slices read in parallel\n", file_size, size);
+        print_data("Original (sample)", plain, length);
+    }
+    
+    // Encryption (multiple iterations for timing), verified as in the default mode
+    MPI_Barrier(MPI_COMM_WORLD);
+    unsigned long long mismatch = file_size;
+    DEA_Digest digest;
+    dea_digest_init(&digest);
+    for (int j = 0; j < num_iterations; j++) {
+        start_cycles = get_cycles();
+        size_t bad = length;
+        if (opts->checksum) {
+            DEA_Digest pass;
+            dea_digest_init(&pass);
+            bad = dea_encrypt_digest_parallel(pool, plan, offset, plain, length, cipher, &pass);
+            if (j == 0) {
+                digest = pass;
+            }
+        } else if (opts->full_verify) {
+            dea_encrypt_parallel(pool, plan, offset, plain, length, cipher);
+        } else {
+            bad = dea_encrypt_verified_parallel(pool, plan, offset, plain, length, cipher);
+        }
+        if (bad != length && offset + bad < mismatch) {
+            mismatch = offset + bad;
+        }
+        cycles[ENCRYPT] += get_cycles() - start_cycles;
+    }
+    cycles[ENCRYPT] /= num_iterations;
+    if (rank == 0) {
+        print_data("Encrypted (sample)", cipher, length);
+    }
+    
+    // Every rank writes its own ciphertext text before decrypting in place
+    start_cycles = get_cycles();
+    int encrypted_ok = write_ascii_at_all(MPI_COMM_WORLD, encrypted_file, cipher, length);
+    cycles[WRITE] = get_cycles() - start_cycles;
+    
+    // The fused check has already proven the round trip unless --full-verify
+    uint8_t *decrypted = plain;
+    int verified = 1;
+    if (opts->full_verify) {
+        start_cycles = get_cycles();
+        dea_encrypt_parallel(pool, plan, offset, cipher, length, cipher);
+        verified = memcmp(plain, cipher, length) == 0;
+        cycles[DECRYPT] = get_cycles() - start_cycles;
+        decrypted = cipher;
+    }
+    
+    start_cycles = get_cycles();
+    int decrypted_ok = MPI_File_open(MPI_COMM_WORLD, (char*)decrypted_file, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                                     MPI_INFO_NULL, &fh) == MPI_SUCCESS;
+    if (decrypted_ok) {
+        decrypted_ok = MPI_File_set_size(fh, total_size) == MPI_SUCCESS;
+        decrypted_ok = file_at_all(fh, (MPI_Offset)offset, decrypted, length, 1) && decrypted_ok;
+        MPI_File_close(&fh);
+    }
+    cycles[WRITE] += get_cycles() - start_cycles;
+    
+    // Combine results: first mismatch, all slices verified, merged digests,
+    // and the slowest rank's time for every phase
+    unsigned long long first_mismatch = file_size;
+    int all_verified = 0;
+    MPI_Reduce(&mismatch, &first_mismatch, 1, MPI_UNSIGNED_LONG_LONG, MPI_MIN, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&verified, &all_verified, 1, MPI_INT, MPI_MIN, 0, MPI_COMM_WORLD);
+    MPI_Reduce(cycles, slowest, PHASES, MPI_UNSIGNED_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+    DEA_Digest *digests = NULL;
+    if (opts->checksum) {
+        digests = rank == 0 ? malloc(size * sizeof(DEA_Digest)) : NULL;
+        if (rank == 0 && !digests) {
+            printf("Memory allocation failed\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+            return 1;
+        }
+        MPI_Gather(&digest, sizeof(DEA_Digest), MPI_BYTE, digests, sizeof(DEA_Digest), MPI_BYTE, 0, MPI_COMM_WORLD);
+    }
+    free(bounds);
+    free(plain);
+    free(cipher);
+    if (rank != 0) {
+        return 0;
+    }
+    
+    if (!read_ok) {
+        printf("Error: Reading %s failed\n", input_file);
+    }
+    printf(encrypted_ok ? "Encrypted data (as ASCII numbers) written to %s\n"
+                        : "Failed to write encrypted data to %s\n", encrypted_file);
+    printf(decrypted_ok ? "Decrypted data written to %s\n"
+                        : "Failed to write decrypted data to %s\n", decrypted_file);
+    if (opts->checksum) {
+        for (int i = 1; i < size; i++) {
+            dea_digest_merge(&digests[0], &digests[i]);
+        }
+        printf("Plaintext CRC32C:  %08X (%llu bytes)\n", digests[0].plain_crc, (unsigned long long)digests[0].length);
+        printf("Ciphertext CRC32C: %08X\n", digests[0].cipher_crc);
+        free(digests);
+    }
+    
+    int success = read_ok && all_verified && first_mismatch == file_size;
+    if (success) {
+        printf("\nVerification SUCCESSFUL - The decrypted text matches the original!\n");
+    } else {
+        printf("\nVerification FAILED - The decrypted text does not match the original!\n");
+        if (first_mismatch != file_size) {
+            printf("First mismatch at byte %llu\n", first_mismatch);
+        }
+    }
+    
+    uint64_t total_cycles = slowest[READ] + slowest[ENCRYPT] + slowest[DECRYPT] + slowest[WRITE];
+    if (file_size == 0 || total_cycles == 0) {
+        return success ? 0 : 1;
+    }
+    double mb = file_size / (1024.0 * 1024.0);
+    printf("\n=== Performance Results (%zuMB file, %d processes, MPI-IO, slowest rank) ===\n",
+           (file_size / (1024 * 1024)) + ((file_size % (1024 * 1024)) ? 1 : 0), size);
+    printf("File read:     %llu cycles (%.3f ms) (%.1f MB/s aggregate)\n", (unsigned long long)slowest[READ],
+           cycles_to_ms(slowest[READ]), mb / (cycles_to_ms(slowest[READ]) / 1000.0));
+    printf("Encryption:    %llu cycles (%.3f ms)\n", (unsigned long long)slowest[ENCRYPT], cycles_to_ms(slowest[ENCRYPT]));
+    printf("Decryption:    %llu cycles (%.3f ms)\n", (unsigned long long)slowest[DECRYPT], cycles_to_ms(slowest[DECRYPT]));
+    printf("File write:    %llu cycles (%.3f ms)\n", (unsigned long long)slowest[WRITE], cycles_to_ms(slowest[WRITE]));
+    printf("Total:         %llu cycles (%.3f ms)\n", (unsigned long long)total_cycles, cycles_to_ms(total_cycles));
+    return success ? 0 : 1;
+}
+
+// Shared-memory mode. The ranks of a node (MPI_COMM_TYPE_SHARED) share one
+// MPI_Win_allocate_shared window holding the node's span of the plaintext
+// followed by its span of the ciphertext. The master reads its own node's
+// span from the file straight into its window and stages only the other
+// nodes' spans, which go to their leaders (node rank 0) in an inter-node
+// scatter that lands directly in their windows. Every rank then encrypts its slice from one half of the window
+// into the other without a message or a copy, and writes its ciphertext
+// text from there with MPI-IO. Slices are handed out in node order (the
+// `order` communicator sorts ranks by node, then node rank), so each node's
+// slices form one contiguous span whatever the rank mapping. Returns the
+// process exit code (meaningful on the master).
+int run_shared(DEA_Pool *pool, const Options *opts, const DEA_Plan *plan, int rank, int size,
+               int num_iterations, const char *input_file, const char *encrypted_file, const char *decrypted_file) {
+    enum { LOAD, TRANSFER, ENCRYPT, DECRYPT, WRITE, PHASES };
+    uint64_t cycles[PHASES] = { 0, 0, 0, 0, 0 }, slowest[PHASES];
+    
+    // Node, node-leader and file-order communicators. Rank 0 leads its node
+    // and is leader 0 and slot 0, so it stays the root everywhere.
+    MPI_Comm node, leaders, order;
+    int node_rank, node_size, slot;
+    int ids[2] = { 0, 0 };   // This node's index among the leaders, number of nodes
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node);
+    MPI_Comm_rank(node, &node_rank);
+    MPI_Comm_size(node, &node_size);
+    MPI_Comm_split(MPI_COMM_WORLD, node_rank == 0 ? 0 : MPI_UNDEFINED, rank, &leaders);
+    if (node_rank == 0) {
+        MPI_Comm_rank(leaders, &ids[0]);
+        MPI_Comm_size(leaders, &ids[1]);
+    }
+    MPI_Bcast(ids, 2, MPI_INT, 0, node);
+    MPI_Comm_split(MPI_COMM_WORLD, 0, ids[0] * size + node_rank, &order);
+    MPI_Comm_rank(order, &slot);
+    
+    // The master opens the file and every rank learns its size
+    FILE *input = NULL;
+    unsigned long long file_size = 0;
+    uint64_t start_cycles = get_cycles();
+    if (rank == 0) {
+        printf("Nodes: %d (%d ranks on the master's node)\n", ids[1], node_size);
+        input = fopen(input_file, "rb");
+        if (!input) {
+            printf("Error: Could not open file %s\n", input_file);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+            return 1;
+        }
+        fseek(input, 0, SEEK_END);
+        file_size = (unsigned long long)ftell(input);
+        fseek(input, 0, SEEK_SET);
+    }
+    cycles[LOAD] = get_cycles() - start_cycles;
+    MPI_Bcast(&file_size, 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+    
+    // This rank's slice, and its node's span: the slices of slots
+    // slot - node_rank to slot - node_rank + node_size - 1
+    size_t *bounds = compute_chunk_bounds(order, (size_t)file_size, slot, size, plan->num_keys);
+    size_t node_start = bounds[slot - node_rank];
+    size_t node_length = bounds[slot - node_rank + node_size] - node_start;
+    size_t offset = bounds[slot];
+    size_t length = bounds[slot + 1] - offset;
+    
+    // The leader allocates the window; the other ranks map the same memory
+    uint8_t *window = NULL;
+    MPI_Win win;
+    MPI_Aint window_size = node_rank == 0 ? (MPI_Aint)(2 * node_length) : 0;
+    MPI_Win_allocate_shared(window_size, 1, MPI_INFO_NULL, node, &window, &win);
+    if (node_rank != 0) {
+        int disp_unit;
+        MPI_Win_shared_query(win, 0, &window_size, &disp_unit, &window);
+    }
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+    uint8_t *node_plain = window;
+    uint8_t *node_cipher = node_length > 0 ? window + node_length : window;
+    uint8_t *plain = node_plain + (offset - node_start);
+    uint8_t *cipher = node_cipher + (offset - node_start);
+    
+    // The master reads its node's span into the window and the rest of the
+    // file, the other nodes' spans, into a staging buffer for the scatter
+    size_t remote = (size_t)file_size - node_length;
+    uint8_t *staging = NULL;
+    if (rank == 0) {
+        start_cycles = get_cycles();
+        staging = remote > 0 ? malloc(remote) : NULL;
+        if (remote > 0 && !staging) {
+            printf("Memory allocation failed\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+            return 1;
+        }
+        if (fread(node_plain, 1, node_length, input) != node_length ||
+            fread(staging, 1, remote, input) != remote) {
+            printf("Error: Could not read file %s\n", input_file);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+            return 1;
+        }
+        fclose(input);
+        cycles[LOAD] += get_cycles() - start_cycles;
+        print_data("Original (sample)", node_plain, node_length);
+    }
+    
+    // Inter-node transfer: leaders only, straight into their windows. The
+    // node boundaries are taken relative to the end of the master's span, so
+    // the master's own chunk is empty and `staging` holds all the others.
+    MPI_Barrier(MPI_COMM_WORLD);
+    start_cycles = get_cycles();
+    size_t *node_bounds = NULL;
+    if (node_rank == 0) {
+        node_bounds = malloc((ids[1] + 1) * sizeof(size_t));
+        if (!node_bounds) {
+            printf("Process %d: Memory allocation failed\n", rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+            return 1;
+        }
+        MPI_Allgather(&node_start, 1, MPI_UNSIGNED_LONG_LONG, node_bounds, 1, MPI_UNSIGNED_LONG_LONG, leaders);
+        node_bounds[ids[1]] = (size_t)file_size;
+        size_t master_span = ids[1] > 1 ? node_bounds[1] : (size_t)file_size;
+        for (int i = 1; i <= ids[1]; i++) {
+            node_bounds[i] -= master_span;
+        }
+        exchange_chunks(leaders, staging, node_bounds, ids[0], ids[1], node_plain, 0);
+    }
+    // Make the leader's stores visible to the rest of the node
+    MPI_Win_sync(win);
+    MPI_Barrier(node);
+    MPI_Win_sync(win);
+    cycles[TRANSFER] = get_cycles() - start_cycles;
+    
+    // Encryption (multiple iterations for timing) from one half of the
+    // window into the other, verified as in the default mode
+    MPI_Barrier(MPI_COMM_WORLD);
+    unsigned long long mismatch = file_size;
+    DEA_Digest digest;
+    dea_digest_init(&digest);
+    for (int j = 0; j < num_iterations; j++) {
+        start_cycles = get_cycles();
+        size_t bad = length;
+        if (opts->checksum) {
+            DEA_Digest pass;
+            dea_digest_init(&pass);
+            bad = dea_encrypt_digest_parallel(pool, plan, offset, plain, length, cipher, &pass);
+            if (j == 0) {
+                digest = pass;
+            }
+        } else if (opts->full_verify) {
+            dea_encrypt_parallel(pool, plan, offset, plain, length, cipher);
+        } else {
+            bad = dea_encrypt_verified_parallel(pool, plan, offset, plain, length, cipher);
+        }
+        if (bad != length && offset + bad < mismatch) {
+            mismatch = offset + bad;
+        }
+        cycles[ENCRYPT] += get_cycles() - start_cycles;
+    }
+    cycles[ENCRYPT] /= num_iterations;
+    if (rank == 0) {
+        print_data("Encrypted (sample)", cipher, length);
+    }
+    
+    // Every rank writes its ciphertext text straight from the window
+    start_cycles = get_cycles();
+    int encrypted_ok = write_ascii_at_all(order, encrypted_file, cipher, length);
+    cycles[WRITE] = get_cycles() - start_cycles;
+    
+    // With --full-verify every rank decrypts its slice in place and compares
+    // it with the plaintext half; the leaders then gather the other nodes'
+    // decrypted spans into the master's staging buffer. Otherwise the fused
+    // check has proven the round trip and the plaintext is the decrypted
+    // output: the master's window and staging buffer then still hold it.
+    int verified = 1;
+    uint8_t *decrypted = node_plain;
+    if (opts->full_verify) {
+        start_cycles = get_cycles();
+        dea_encrypt_parallel(pool, plan, offset, cipher, length, cipher);
+        verified = memcmp(plain, cipher, length) == 0;
+        cycles[DECRYPT] = get_cycles() - start_cycles;
+        MPI_Win_sync(win);
+        MPI_Barrier(node);
+        MPI_Win_sync(win);
+        if (node_rank == 0) {
+            exchange_chunks(leaders, staging, node_bounds, ids[0], ids[1], node_cipher, 1);
+        }
+        decrypted = node_cipher;
+    }
+    
+    // Combine results: first mismatch, all slices verified, digests merged in
+    // stream order, and the slowest rank's time for every phase
+    unsigned long long first_mismatch = file_size;
+    int all_verified = 0;
+    MPI_Reduce(&mismatch, &first_mismatch, 1, MPI_UNSIGNED_LONG_LONG, MPI_MIN, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&verified, &all_verified, 1, MPI_INT, MPI_MIN, 0, MPI_COMM_WORLD);
+    DEA_Digest *digests = NULL;
+    if (opts->checksum) {
+        digests = rank == 0 ? malloc(size * sizeof(DEA_Digest)) : NULL;
+        if (rank == 0 && !digests) {
+            printf("Memory allocation failed\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+            return 1;
+        }
+        MPI_Gather(&digest, sizeof(DEA_Digest), MPI_BYTE, digests, sizeof(DEA_Digest), MPI_BYTE, 0, order);
+    }
+    
+    // The master writes its node's span from the window, then the rest
+    int decrypted_ok = 1;
+    if (rank == 0) {
+        start_cycles = get_cycles();
+        FILE *output = fopen(decrypted_file, "wb");
+        decrypted_ok = output &&
+                       (node_length == 0 || fwrite(decrypted, 1, node_length, output) == node_length) &&
+                       (remote == 0 || fwrite(staging, 1, remote, output) == remote);
+        if (output && fclose(output) != 0) {
+            decrypted_ok = 0;
+        }
+        cycles[WRITE] += get_cycles() - start_cycles;
+    }
+    MPI_Reduce(cycles, slowest, PHASES, MPI_UNSIGNED_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+    
+    MPI_Win_unlock_all(win);
+    MPI_Win_free(&win);
+    if (leaders != MPI_COMM_NULL) {
+        MPI_Comm_free(&leaders);
+    }
+    MPI_Comm_free(&node);
+    MPI_Comm_free(&order);
+    free(node_bounds);
+    free(bounds);
+    free(staging);
+    if (rank != 0) {
+        return 0;
+    }
+    
+    printf(encrypted_ok ? "Encrypted data (as ASCII numbers) written to %s\n"
+                        : "Failed to write encrypted data to %s\n", encrypted_file);
+    printf(decrypted_ok ? "Decrypted data written to %s\n"
+                        : "Failed to write decrypted data to %s\n", decrypted_file);
+    if (opts->checksum) {
+        for (int i = 1; i < size; i++) {
+            dea_digest_merge(&digests[0], &digests[i]);
+        }
+        printf("Plaintext CRC32C:  %08X (%llu bytes)\n", digests[0].plain_crc, (unsigned long long)digests[0].length);
+        printf("Ciphertext CRC32C: %08X\n", digests[0].cipher_crc);
+        free(digests);
+    }
+    
+    int success = all_verified && first_mismatch == file_size;
+    if (success) {
+        printf("\nVerification SUCCESSFUL - The decrypted text matches the original!\n");
+    } else {
+        printf("\nVerification FAILED - The decrypted text does not match the original!\n");
+        if (first_mismatch != file_size) {
+            printf("First mismatch at byte %llu\n", first_mismatch);
+        }
+    }
+    
+    uint64_t total_cycles = 0;
+    for (int i = 0; i < PHASES; i++) {
+        total_cycles += slowest[i];
+    }
+    if (file_size == 0 || total_cycles == 0) {
+        return success ? 0 : 1;
+    }
+    printf("\n=== Performance Results (%lluMB file, %d processes on %d nodes, shared windows, slowest rank) ===\n",
+           (file_size / (1024 * 1024)) + ((file_size % (1024 * 1024)) ? 1 : 0), size, ids[1]);
+    printf("File load:     %llu cycles (%.3f ms)\n", (unsigned long long)slowest[LOAD], cycles_to_ms(slowest[LOAD]));
+    printf("Distribution:  %llu cycles (%.3f ms) (into the node windows)\n", (unsigned long long)slowest[TRANSFER],
+           cycles_to_ms(slowest[TRANSFER]));
+    printf("Encryption:    %llu cycles (%.3f ms)\n", (unsigned long long)slowest[ENCRYPT], cycles_to_ms(slowest[ENCRYPT]));
+    printf("Decryption:    %llu cycles (%.3f ms)\n", (unsigned long long)slowest[DECRYPT], cycles_to_ms(slowest[DECRYPT]));
+    printf("File write:    %llu cycles (%.3f ms)\n", (unsigned long long)slowest[WRITE], cycles_to_ms(slowest[WRITE]));
+    printf("Total:         %llu cycles (%.3f ms)\n", (unsigned long long)total_cycles, cycles_to_ms(total_cycles));
+    return success ? 0 : 1;
+}
+
 int main(int argc, char *argv[]) {
     int rank, size, i, j;
-    MPI_Status status;
     uint64_t start_cycles, end_cycles;
     uint64_t load_cycles = 0, encrypt_cycles = 0, decrypt_cycles = 0, write_cycles = 0, total_cycles = 0;
     size_t file_size = 0;
     
-    // Initialize MPI
-    MPI_Init(&argc, &argv);
+    // Initialize MPI. Ranks may run a thread team, but only the main thread
+    // ever calls MPI, so FUNNELED is all that is needed.
+    int provided = MPI_THREAD_SINGLE;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
     
+    Options opts;
+    if (!parse_options(argc, argv, rank, &opts)) {
+        MPI_Finalize();
+        return 1;
+    }
+    if (opts.threads != 1 && provided < MPI_THREAD_FUNNELED) {
+        if (rank == 0) {
+            printf("Note: this MPI library does not support threads, --threads has no effect\n");
+        }
+        opts.threads = 1;
+    }
+    DEA_Pool *pool = create_rank_pool(opts.threads, rank);
+    
+    // Key schedule shared by all ranks (same keys as the serial implementation)
+    const uint8_t keys[4] = { 0xAA, 0xBB, 0xCC, 0xDD };
+    DEA_Plan plan;
+    dea_plan_init(&plan, keys, 4);
+    
     // Input/output file names
     const char* input_file = "test_input.txt";
     const char* encrypted_file = "encrypted_output.bin";
@@ -136,7 +1211,71 @@ int main(int argc, char *argv[]) {
     // Number of iterations for more accurate timing
     const int num_iterations = 10;
     
+    // Shared-memory mode: node-local ranks work in one window, leaders communicate
+    if (opts.shared) {
+        if (rank == 0) {
+            printf("=== MPI Multi-Key DEA Encryption Test (shared-memory windows) ===\n");
+            printf("Number of processes: %d\n", size);
+            printf("Threads per rank: %d\n", dea_pool_threads(pool));
+            printf("Input file: %s\n", input_file);
+            printf("Number of iterations: %d\n", num_iterations);
+            printf("Encryption kernel: %s\n", dea_kernel_name());
+            if (opts.in_place || opts.mmap_io || opts.stream_window || opts.mpi_io) {
+                printf("Note: --in-place, --mmap, --stream, --pipeline and --mpi-io have no effect with --shared\n");
+            }
+            printf("Verification: %s\n", opts.full_verify ? "separate decryption pass on every rank" : "fused with encryption");
+        }
+        int status = run_shared(pool, &opts, &plan, rank, size, num_iterations, input_file, encrypted_file, decrypted_file);
+        dea_pool_destroy(pool);
+        MPI_Finalize();
+        return status;
+    }
+    
+    // MPI-IO mode: no rank-0 file I/O at all
+    if (opts.mpi_io) {
+        if (rank == 0) {
+            printf("=== MPI Multi-Key DEA Encryption Test (MPI-IO) ===\n");
+            printf("Number of processes: %d\n", size);
+            printf("Threads per rank: %d\n", dea_pool_threads(pool));
+            printf("Input file: %s\n", input_file);
+            printf("Number of iterations: %d\n", num_iterations);
+            printf("Encryption kernel: %s\n", dea_kernel_name());
+            if (opts.in_place || opts.mmap_io || opts.stream_window) {
+                printf("Note: --in-place, --mmap, --stream and --pipeline have no effect with --mpi-io\n");
+            }
+            printf("Verification: %s\n", opts.full_verify ? "separate decryption pass on every rank" : "fused with encryption");
+        }
+        int status = run_mpi_io(pool, &opts, &plan, rank, size, num_iterations, input_file, encrypted_file, decrypted_file);
+        dea_pool_destroy(pool);
+        MPI_Finalize();
+        return status;
+    }
+    
+    // Streaming mode makes one bounded-memory pass instead
+    if (opts.stream_window) {
+        int status = 0;
+        if (rank == 0) {
+            printf("=== MPI Multi-Key DEA Encryption Test (streaming) ===\n");
+            printf("Number of processes: %d\n", size);
+            printf("Threads per rank: %d\n", dea_pool_threads(pool));
+            printf("Input file: %s\n", input_file);
+            printf("Encryption kernel: %s\n", dea_kernel_name());
+            if (opts.in_place || opts.mmap_io) {
+                printf("Note: --in-place and --mmap have no effect with --stream\n");
+            }
+            printf("Verification: %s\n", opts.full_verify ? "decryption pass, CRC32C compared" : "fused with encryption");
+            status = run_streaming_master(pool, &opts, &plan, size, input_file, encrypted_file, decrypted_file);
+        } else {
+            run_streaming_worker(pool, &opts, &plan, rank, size);
+        }
+        dea_pool_destroy(pool);
+        MPI_Finalize();
+        return status;
+    }
+    
     char *input_data = NULL;
+    char empty_file[1] = { 0 };   // Stands in for the (absent) mapping of a 0-byte file
+    DEA_Mapping input_map, output_map;
     uint8_t *full_encrypted = NULL;
     uint8_t *full_decrypted = NULL;
     
@@ -144,12 +1283,33 @@ int main(int argc, char *argv[]) {
     if (rank == 0) {
         printf("=== MPI Multi-Key DEA Encryption Test ===\n");
         printf("Number of processes: %d\n", size);
+        printf("Threads per rank: %d\n", dea_pool_threads(pool));
         printf("Input file: %s\n", input_file);
         printf("Number of iterations: %d\n", num_iterations);
+        printf("Encryption kernel: %s\n", dea_kernel_name());
+        if (opts.mmap_io && opts.in_place) {
+            // The mapped input is read-only; the output mapping is the only buffer anyway
+            printf("Note: --in-place has no effect with --mmap\n");
+            opts.in_place = 0;
+        }
+        printf("Buffer mode: %s\n", opts.mmap_io ? "memory-mapped files" :
+                                     opts.in_place ? "in-place" : "separate output buffer");
+        printf("Verification: %s\n", opts.full_verify ? "separate decryption pass" : "fused with encryption");
         
         // Load the input file first to determine size
         start_cycles = get_cycles();
-        input_data = load_file(input_file, &file_size);
+        if (opts.mmap_io) {
+            // Pages are read on first touch (or when sent to a worker)
+            // A 0-byte file has no mapping; it goes down the small-file path
+            if (dea_map_input(input_file, &input_map)) {
+                input_data = input_map.data ? (char*)input_map.data : empty_file;
+                file_size = input_map.size;
+            } else {
+                printf("Error: Could not map file %s\n", input_file);
+            }
+        } else {
+            input_data = load_file(input_file, &file_size);
+        }
         end_cycles = get_cycles();
         load_cycles = end_cycles - start_cycles;
         
@@ -163,8 +1323,9 @@ int main(int argc, char *argv[]) {
         if (file_size <= 4) {
             printf("Small file optimization: File size is only %zu bytes, processing on master only\n", file_size);
             
-            // Broadcast file size to worker processes so they know this is a small file case
-            MPI_Bcast(&file_size, 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+            // Broadcast the file size so the workers know this is a small file case
+            unsigned long long meta[2] = { file_size, (unsigned long long)num_iterations };
+            MPI_Bcast(meta, 2, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
             
             // Allocate buffers
             full_encrypted = malloc(file_size);
@@ -176,14 +1337,6 @@ int main(int argc, char *argv[]) {
                 return 1;
             }
             
-            // Initialize DEA
-            DEA dea;
-            dea_init(&dea);
-            dea_set_key(&dea, 0xAA);
-            dea_set_key(&dea, 0xBB);
-            dea_set_key(&dea, 0xCC);
-            dea_set_key(&dea, 0xDD);
-            
             print_data("Original (sample)", (uint8_t*)input_data, file_size);
             
             // Process entire file on master
@@ -192,9 +1345,8 @@ int main(int argc, char *argv[]) {
             
             // Encryption (multiple iterations for timing)
             for (j = 0; j < num_iterations; j++) {
-                dea_reset(&dea);
                 uint64_t encrypt_start = get_cycles();
-                dea_encrypt_block(&dea, (uint8_t*)input_data, file_size, full_encrypted);
+                dea_crypt_at(&plan, 0, (uint8_t*)input_data, file_size, full_encrypted);
                 uint64_t encrypt_end = get_cycles();
                 encrypt_cycles += (encrypt_end - encrypt_start);
             }
@@ -203,9 +1355,8 @@ int main(int argc, char *argv[]) {
             encrypt_cycles /= num_iterations;
             
             // Decryption
-            dea_reset(&dea);
             uint64_t decrypt_start = get_cycles();
-            dea_decrypt_block(&dea, full_encrypted, file_size, full_decrypted);
+            dea_crypt_at(&plan, 0, full_encrypted, file_size, full_decrypted);
             uint64_t decrypt_end = get_cycles();
             decrypt_cycles = decrypt_end - decrypt_start;
             
@@ -279,10 +1430,15 @@ int main(int argc, char *argv[]) {
             printf("Total:       %.2f cycles/byte\n", (double)total_cycles / file_size);
             
             // Cleanup
-            free(input_data);
+            if (opts.mmap_io) {
+                dea_unmap(&input_map);
+            } else {
+                free(input_data);
+            }
             free(full_encrypted);
             free(full_decrypted);
             
+            dea_pool_destroy(pool);
             MPI_Finalize();
             return 0;
         }
@@ -292,137 +1448,177 @@ int main(int argc, char *argv[]) {
                load_cycles, cycles_to_ms(load_cycles));
         print_data("Original (sample)", (uint8_t*)input_data, file_size);
         
-        // Broadcast file size to all processes
-        MPI_Bcast(&file_size, 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+        // File size and iteration count go to every rank in one broadcast
+        unsigned long long meta[2] = { file_size, (unsigned long long)num_iterations };
+        MPI_Bcast(meta, 2, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
         
         // Calculate chunks for input data
-        int chunk_size = file_size / size;
-        int remainder = file_size % size;
+        size_t *bounds = compute_chunk_bounds(MPI_COMM_WORLD, file_size, rank, size, plan.num_keys);
         
-        // Send chunk sizes to workers (they'll reuse the same chunk for all iterations)
-        for (i = 1; i < size; i++) {
-            int worker_chunk_size = chunk_size + (i < remainder ? 1 : 0);
-            int start_pos = i * chunk_size + (i < remainder ? i : remainder);
-            
-            MPI_Send(&worker_chunk_size, 1, MPI_INT, i, 0, MPI_COMM_WORLD);
-            MPI_Send(&num_iterations, 1, MPI_INT, i, 0, MPI_COMM_WORLD);
-            MPI_Send((void*)&input_data[start_pos], worker_chunk_size, MPI_BYTE, i, 0, MPI_COMM_WORLD);
-        }
+        // Scatter the chunks (workers reuse the same chunk for all iterations)
+        exchange_chunks(MPI_COMM_WORLD, (uint8_t*)input_data, bounds, rank, size, NULL, 0);
         
         // Master's chunk
-        int master_chunk_size = chunk_size + (0 < remainder ? 1 : 0);
+        size_t master_chunk_size = bounds[1];
         
-        // Allocate buffers
-        uint8_t *master_encrypted = malloc(master_chunk_size);
-        full_encrypted = malloc(file_size);
-        full_decrypted = malloc(file_size + 1);
-        
-        if (!master_encrypted || !full_encrypted || !full_decrypted) {
-            printf("Memory allocation failed\n");
-            MPI_Abort(MPI_COMM_WORLD, 1);
-            return 1;
+        // Every chunk is encrypted straight into the final result buffer and
+        // decrypted in place for verification. In in-place mode that buffer
+        // is the input itself, so the master holds one full-size buffer.
+        uint32_t original_checksum = 0;
+        if (opts.mmap_io) {
+            // Chunks are gathered into the mapped output file and decrypted
+            // there, so it holds the plaintext when it is unmapped
+            if (!dea_map_output(decrypted_file, file_size, &output_map)) {
+                printf("Error: Could not map file %s for writing\n", decrypted_file);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+                return 1;
+            }
+            full_encrypted = output_map.data;
+        } else if (opts.in_place) {
+            if (opts.full_verify) {
+                original_checksum = dea_crc32c(0, (uint8_t*)input_data, file_size);
+            }
+            full_encrypted = (uint8_t*)input_data;
+        } else {
+            full_encrypted = malloc(file_size);
+            if (!full_encrypted) {
+                printf("Memory allocation failed\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+                return 1;
+            }
         }
         
-        // Initialize DEA
-        DEA dea;
-        dea_init(&dea);
-        dea_set_key(&dea, 0xAA);
-        dea_set_key(&dea, 0xBB);
-        dea_set_key(&dea, 0xCC);
-        dea_set_key(&dea, 0xDD);
-        
         // Synchronize before timing starts
         MPI_Barrier(MPI_COMM_WORLD);
         encrypt_cycles = 0;
         decrypt_cycles = 0;
         
-        // Multiple iterations for more accurate timing
+        // Multiple iterations for more accurate timing. In place, each pass
+        // toggles the master's chunk between plaintext and ciphertext. By
+        // default every pass also verifies its round trip while in L1.
+        size_t mismatch = file_size;
+        DEA_Digest digest;
+        dea_digest_init(&digest);
         for (j = 0; j < num_iterations; j++) {
-            // Reset DEA key counter for each iteration
-            dea_reset(&dea);
-            
-            // Process master's chunk with timing
+            // Process master's chunk (stream offset 0) with timing
             uint64_t chunk_start = get_cycles();
-            dea_encrypt_block(&dea, (uint8_t*)input_data, master_chunk_size, master_encrypted);
+            if (opts.checksum) {
+                // Only the first pass sees the original plaintext in place
+                DEA_Digest pass;
+                dea_digest_init(&pass);
+                size_t bad = dea_encrypt_digest_parallel(pool, &plan, 0, (uint8_t*)input_data, master_chunk_size, full_encrypted, &pass);
+                if (bad != master_chunk_size && bad < mismatch) {
+                    mismatch = bad;
+                }
+                if (j == 0) {
+                    digest = pass;
+                }
+            } else if (opts.full_verify) {
+                dea_encrypt_parallel(pool, &plan, 0, (uint8_t*)input_data, master_chunk_size, full_encrypted);
+            } else {
+                size_t bad = dea_encrypt_verified_parallel(pool, &plan, 0, (uint8_t*)input_data, master_chunk_size, full_encrypted);
+                if (bad != master_chunk_size && bad < mismatch) {
+                    mismatch = bad;
+                }
+            }
             uint64_t chunk_end = get_cycles();
             encrypt_cycles += (chunk_end - chunk_start);
             
-            // Copy to result buffer
-            memcpy(full_encrypted, master_encrypted, master_chunk_size);
-            
-            // Collect results from workers
+            // Gather the workers' ciphertext next to the master's
+            exchange_chunks(MPI_COMM_WORLD, full_encrypted, bounds, rank, size, NULL, 1);
+        }
+        if (opts.in_place && num_iterations % 2 == 0) {
+            dea_encrypt_parallel(pool, &plan, 0, full_encrypted, master_chunk_size, full_encrypted);
+        }
+        
+        // First mismatching stream offset found by any rank's fused check
+        unsigned long long local_mismatch = mismatch, first_mismatch = file_size;
+        MPI_Reduce(&local_mismatch, &first_mismatch, 1, MPI_UNSIGNED_LONG_LONG, MPI_MIN, 0, MPI_COMM_WORLD);
+        
+        // Merge the per-rank chunk digests in stream order; the result does
+        // not depend on how the file was partitioned
+        if (opts.checksum) {
+            DEA_Digest *digests = malloc(size * sizeof(DEA_Digest));
+            if (!digests) {
+                printf("Memory allocation failed\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+                return 1;
+            }
+            MPI_Gather(&digest, sizeof(DEA_Digest), MPI_BYTE, digests, sizeof(DEA_Digest), MPI_BYTE, 0, MPI_COMM_WORLD);
             for (i = 1; i < size; i++) {
-                int worker_chunk_size = chunk_size + (i < remainder ? 1 : 0);
-                int start_pos = i * chunk_size + (i < remainder ? i : remainder);
-                
-                MPI_Recv(&full_encrypted[start_pos], worker_chunk_size, MPI_BYTE, i, j, MPI_COMM_WORLD, &status);
+                dea_digest_merge(&digest, &digests[i]);
             }
-            
-            // Only decrypt and verify the last iteration
-            if (j == num_iterations - 1) {
-                // Start timing for decryption
-                uint64_t decrypt_start = get_cycles();
-                
-                // We need to decrypt each chunk separately with the correct key offset
-                
-                // First decrypt master's chunk
-                dea_reset(&dea);
-                // Master's chunk starts at the beginning of the file (offset 0)
-                dea_decrypt_block(&dea, full_encrypted, master_chunk_size, full_decrypted);
-                
-                // Now decrypt each worker's chunk with the correct key offset
-                for (i = 1; i < size; i++) {
-                    int worker_chunk_size = chunk_size + (i < remainder ? 1 : 0);
-                    int start_pos = i * chunk_size + (i < remainder ? i : remainder);
-                    
-                    // Calculate key counter offset based on chunk position
-                    int preceding_bytes = 0;
-                    for (int k = 0; k < i; k++) {
-                        preceding_bytes += chunk_size + (k < remainder ? 1 : 0);
-                    }
-                    
-                    // Reset DEA with the correct key offset for this chunk
-                    dea_reset(&dea);
-                    dea.key_counter = preceding_bytes % dea.num_keys;
-                    
-                    // Decrypt this chunk
-                    dea_decrypt_block(&dea, &full_encrypted[start_pos], worker_chunk_size, &full_decrypted[start_pos]);
-                }
-                
-                uint64_t decrypt_end = get_cycles();
-                decrypt_cycles = decrypt_end - decrypt_start;
-                
-                full_decrypted[file_size] = '\0';
-                
-                print_data("Encrypted (sample)", full_encrypted, file_size);
-                print_data("Decrypted (sample)", full_decrypted, file_size);
-                
-                // Check if decryption is correct
-                if (memcmp(input_data, full_decrypted, file_size) == 0) {
-                    printf("\nVerification SUCCESSFUL - The decrypted text matches the original!\n");
-                } else {
-                    printf("\nVerification FAILED - The decrypted text does not match the original!\n");
-                }
-                
-                // Write encrypted data to file
-                start_cycles = get_cycles();
-                if (write_file_as_ascii(encrypted_file, full_encrypted, file_size)) {
-                    printf("Encrypted data (as ASCII numbers) written to %s\n", encrypted_file);
-                } else {
-                    printf("Failed to write encrypted data\n");
-                }
-                
-                // Write decrypted data to file
-                if (write_file(decrypted_file, full_decrypted, file_size)) {
-                    printf("Decrypted data written to %s\n", decrypted_file);
-                } else {
-                    printf("Failed to write decrypted data\n");
-                }
-                end_cycles = get_cycles();
-                write_cycles = end_cycles - start_cycles;
+            free(digests);
+        }
+        
+        print_data("Encrypted (sample)", full_encrypted, file_size);
+        if (opts.checksum) {
+            printf("Plaintext CRC32C:  %08X (%llu bytes)\n", digest.plain_crc, (unsigned long long)digest.length);
+            printf("Ciphertext CRC32C: %08X\n", digest.cipher_crc);
+        }
+        
+        // Write encrypted data to file before it is decrypted in place. Every
+        // rank formats and writes its own chunk; the master's is at offset 0.
+        start_cycles = get_cycles();
+        if (write_ascii_at_all(MPI_COMM_WORLD, encrypted_file, full_encrypted, master_chunk_size)) {
+            printf("Encrypted data (as ASCII numbers) written to %s\n", encrypted_file);
+        } else {
+            printf("Failed to write encrypted data\n");
+        }
+        end_cycles = get_cycles();
+        write_cycles = end_cycles - start_cycles;
+        
+        // Decrypt when the plaintext is needed again: for the separate
+        // verification pass, to recover it in in-place mode, or to leave it
+        // in the mapped output file. The key phase
+        // follows from the absolute offset, so the assembled ciphertext
+        // decrypts in one in-place pass regardless of chunking. Otherwise the
+        // fused check has already proven the round trip on every rank.
+        full_decrypted = (uint8_t*)input_data;
+        if (opts.full_verify || opts.in_place || opts.mmap_io) {
+            uint64_t decrypt_start = get_cycles();
+            dea_encrypt_parallel(pool, &plan, 0, full_encrypted, file_size, full_encrypted);
+            uint64_t decrypt_end = get_cycles();
+            decrypt_cycles = decrypt_end - decrypt_start;
+            full_decrypted = full_encrypted;
+        }
+        
+        print_data("Decrypted (sample)", full_decrypted, file_size);
+        
+        // Check if decryption is correct
+        int verified;
+        if (opts.full_verify) {
+            verified = opts.in_place ? dea_crc32c(0, full_decrypted, file_size) == original_checksum
+                                     : memcmp(input_data, full_decrypted, file_size) == 0;
+        } else {
+            verified = first_mismatch == file_size;
+        }
+        if (opts.full_verify && opts.checksum && first_mismatch != file_size) {
+            verified = 0;
+        }
+        if (verified) {
+            printf("\nVerification SUCCESSFUL - The decrypted text matches the original!\n");
+        } else {
+            printf("\nVerification FAILED - The decrypted text does not match the original!\n");
+            if (first_mismatch != file_size) {
+                printf("First mismatch at byte %llu\n", first_mismatch);
             }
         }
         
+        // Write decrypted data to file
+        start_cycles = get_cycles();
+        if (opts.mmap_io) {
+            // Already in the page cache of the output file; the OS writes it back
+            dea_unmap(&output_map);
+            printf("Decrypted data mapped to %s\n", decrypted_file);
+        } else if (write_file(decrypted_file, full_decrypted, file_size)) {
+            printf("Decrypted data written to %s\n", decrypted_file);
+        } else {
+            printf("Failed to write decrypted data\n");
+        }
+        end_cycles = get_cycles();
+        write_cycles += end_cycles - start_cycles;
+        
         // Calculate average encryption time per iteration
         encrypt_cycles /= num_iterations;
         
@@ -456,7 +1652,11 @@ int main(int argc, char *argv[]) {
         double decrypt_mb_per_second = ((file_size) / 1024.0 / 1024.0) / (cycles_to_ms(decrypt_cycles) / 1000.0);
         printf("\nThroughput:\n");
         printf("Encryption:  %.2f MB/s\n", encrypt_mb_per_second);
-        printf("Decryption:  %.2f MB/s\n", decrypt_mb_per_second);
+        if (decrypt_cycles > 0) {
+            printf("Decryption:  %.2f MB/s\n", decrypt_mb_per_second);
+        } else {
+            printf("Decryption:  skipped (round trip verified during encryption)\n");
+        }
         
         printf("\nCycles per byte:\n");
         printf("File load:   %.2f cycles/byte\n", (double)load_cycles / file_size);
@@ -472,32 +1672,40 @@ int main(int argc, char *argv[]) {
         printf("Parallel efficiency: %.2f%%\n", 100.0);  // We'd need single-process benchmark to calculate actual efficiency
         
         // Cleanup
-        free(input_data);
-        free(master_encrypted);
-        free(full_encrypted);
-        free(full_decrypted);
+        free(bounds);
+        if (opts.mmap_io) {
+            dea_unmap(&input_map);
+        } else {
+            if (full_encrypted != (uint8_t*)input_data) {
+                free(full_encrypted);
+            }
+            free(input_data);
+        }
     }
     // Worker processes
     else {
-        // Receive file size from master
-        MPI_Bcast(&file_size, 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+        // Receive the file size and iteration count from the master
+        unsigned long long meta[2];
+        MPI_Bcast(meta, 2, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+        file_size = (size_t)meta[0];
+        int iterations = (int)meta[1];
         
         // For very small files, master handles everything
         if (file_size <= 4) {
             // Exit early - master is handling the small file
+            dea_pool_destroy(pool);
             MPI_Finalize();
             return 0;
         }
         
-        int chunk_size, iterations;
-        
-        // Receive chunk size and iteration count
-        MPI_Recv(&chunk_size, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, &status);
-        MPI_Recv(&iterations, 1, MPI_INT, 0, 0, MPI_COMM_WORLD, &status);
+        // This rank's chunk and its stream offset; the key phase is derived from it
+        size_t *bounds = compute_chunk_bounds(MPI_COMM_WORLD, file_size, rank, size, plan.num_keys);
+        size_t chunk_size = bounds[rank + 1] - bounds[rank];
+        size_t start_pos = bounds[rank];
         
-        // Receive data (same chunk used for all iterations)
-        uint8_t *chunk_data = malloc(chunk_size);
-        uint8_t *encrypted_chunk = malloc(chunk_size);
+        // Receive data (same chunk used for all iterations); chunks can be empty for tiny files
+        uint8_t *chunk_data = malloc(chunk_size > 0 ? chunk_size : 1);
+        uint8_t *encrypted_chunk = malloc(chunk_size > 0 ? chunk_size : 1);
         
         if (!chunk_data || !encrypted_chunk) {
             printf("Worker %d: Memory allocation failed\n", rank);
@@ -505,43 +1713,42 @@ int main(int argc, char *argv[]) {
             return 1;
         }
         
-        MPI_Recv(chunk_data, chunk_size, MPI_BYTE, 0, 0, MPI_COMM_WORLD, &status);
+        exchange_chunks(MPI_COMM_WORLD, NULL, bounds, rank, size, chunk_data, 0);
         
-        printf("Process %d received %d bytes, will encrypt for %d iterations\n", 
+        printf("Process %d received %zu bytes, will encrypt for %d iterations\n", 
                rank, chunk_size, iterations);
         
-        // Initialize DEA
-        DEA dea;
-        dea_init(&dea);
-        dea_set_key(&dea, 0xAA);
-        dea_set_key(&dea, 0xBB);
-        dea_set_key(&dea, 0xCC);
-        dea_set_key(&dea, 0xDD);
-        
-        // Calculate key counter offset based on chunk position
-        int chunk_size_base = file_size / size;
-        int remainder = file_size % size;
-        int preceding_bytes = 0;
-        
-        for (i = 0; i < rank; i++) {
-            preceding_bytes += chunk_size_base + (i < remainder ? 1 : 0);
-        }
-        
-        printf("Process %d: key counter offset is %d bytes (mod %d = %d)\n", 
-               rank, preceding_bytes, dea.num_keys, preceding_bytes % dea.num_keys);
+        printf("Process %d: key counter offset is %zu bytes (mod %d = %d)\n", 
+               rank, start_pos, plan.num_keys, (int)(start_pos % plan.period));
         
         // Synchronize before timing starts
         MPI_Barrier(MPI_COMM_WORLD);
         
         // Multiple iterations
+        size_t mismatch = file_size;
+        DEA_Digest digest;
+        dea_digest_init(&digest);
         for (j = 0; j < iterations; j++) {
-            // Reset DEA key counter for each iteration with proper offset
-            dea_reset(&dea);
-            dea.key_counter = preceding_bytes % dea.num_keys;
-            
-            // Encrypt the chunk
+            // Encrypt the chunk at its offset in the stream
             uint64_t chunk_start = get_cycles();
-            dea_encrypt_block(&dea, chunk_data, chunk_size, encrypted_chunk);
+            if (opts.checksum) {
+                DEA_Digest pass;
+                dea_digest_init(&pass);
+                size_t bad = dea_encrypt_digest_parallel(pool, &plan, start_pos, chunk_data, chunk_size, encrypted_chunk, &pass);
+                if (bad != chunk_size && start_pos + bad < mismatch) {
+                    mismatch = start_pos + bad;
+                }
+                if (j == 0) {
+                    digest = pass;
+                }
+            } else if (opts.full_verify) {
+                dea_encrypt_parallel(pool, &plan, start_pos, chunk_data, chunk_size, encrypted_chunk);
+            } else {
+                size_t bad = dea_encrypt_verified_parallel(pool, &plan, start_pos, chunk_data, chunk_size, encrypted_chunk);
+                if (bad != chunk_size && start_pos + bad < mismatch) {
+                    mismatch = start_pos + bad;
+                }
+            }
             uint64_t chunk_end = get_cycles();
             
             // Report timing if needed
@@ -551,14 +1758,28 @@ int main(int argc, char *argv[]) {
             }
             
             // Send back encrypted data
-            MPI_Send(encrypted_chunk, chunk_size, MPI_BYTE, 0, j, MPI_COMM_WORLD);
+            exchange_chunks(MPI_COMM_WORLD, NULL, bounds, rank, size, encrypted_chunk, 1);
         }
         
+        // Report the first fused-check mismatch (file_size if none) to the master
+        unsigned long long local_mismatch = mismatch;
+        MPI_Reduce(&local_mismatch, NULL, 1, MPI_UNSIGNED_LONG_LONG, MPI_MIN, 0, MPI_COMM_WORLD);
+        
+        // Send the chunk digest to the master for merging
+        if (opts.checksum) {
+            MPI_Gather(&digest, sizeof(DEA_Digest), MPI_BYTE, NULL, sizeof(DEA_Digest), MPI_BYTE, 0, MPI_COMM_WORLD);
+        }
+        
+        // Write this chunk's share of the ASCII output at its own offset
+        write_ascii_at_all(MPI_COMM_WORLD, encrypted_file, encrypted_chunk, chunk_size);
+        
         // Cleanup
+        free(bounds);
         free(chunk_data);
         free(encrypted_chunk);
     }
     
+    dea_pool_destroy(pool);
     MPI_Finalize();
     return 0;
 }
\ No newline at end of file
@@ -98,35 +98,758 @@ int write_file(const char* filename, const void* data, size_t size) {
     return 1;
 }
 
-// Function to write data as ASCII decimal values to a file
-int write_file_as_ascii(const char* filename, const void* data, size_t size) {
-    FILE* file = fopen(filename, "w"); // Text mode, not binary
-    if (!file) {
-        printf("Error: Could not open file %s for writing\n", filename);
+// Bytes formatted per fwrite by append_ascii
+#define ASCII_BLOCK 16384
+
+// Function to append data as ASCII decimal values to an open file. Blocks
+// of bytes are formatted with the lookup table of dea_format_decimal and
+// written with one fwrite each, instead of one fprintf per byte.
+int append_ascii(FILE* file, const uint8_t* bytes, size_t size) {
+    char text[ASCII_BLOCK * DEA_DECIMAL_MAX_CHARS];
+    for (size_t i = 0; i < size; i += ASCII_BLOCK) {
+        size_t count = size - i < ASCII_BLOCK ? size - i : ASCII_BLOCK;
+        size_t length = dea_format_decimal(bytes + i, count, text);
+        if (fwrite(text, 1, length, file) != length) {
+            printf("Error writing to file at position %zu\n", i);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Function to write data as ASCII decimal values to a file. Every pool
+// worker formats its own slice and writes it at its offset in the file.
+int write_file_as_ascii(DEA_Pool *pool, const char* filename, const void* data, size_t size) {
+    if (!dea_write_decimal(pool, filename, (const uint8_t*)data, size)) {
+        printf("Error: Could not write file %s\n", filename);
         return 0;
     }
-    
-    const uint8_t* bytes = (const uint8_t*)data;
-    for (size_t i = 0; i < size; i++) {
-        if (fprintf(file, "%d ", bytes[i]) < 0) {
-            printf("Error writing to file at position %zu\n", i);
-            fclose(file);
+    return 1;
+}
+
+// Command-line options
+typedef struct {
+    int in_place;   // Encrypt and decrypt inside the input buffer (one full-size buffer)
+    int threads;    // Worker threads (1 = serial, 0 = every CPU allowed by affinity/cgroup quota)
+    int full_verify; // Verify with a separate decryption pass instead of the fused kernel
+    int checksum;   // Report CRC32C digests of the plaintext and ciphertext
+    int mmap_io;    // Memory-map the input and the decrypted output file instead of read/write
+    size_t stream_window; // Stream the file through windows of this many bytes (0 = load it whole)
+    int pipeline;   // Run the reader/encryptor/writer pipeline
+    int pipeline_workers; // Encryption threads in the pipeline (0 = all available CPUs)
+    int aio;        // Encrypt file to file with asynchronous I/O (io_uring or pread/pwrite)
+    int direct;     // With --aio: bypass the page cache (O_DIRECT)
+    int container;  // Encrypt into an indexed binary container file
+    const char *decrypt_input;  // Decrypt this ciphertext file (ASCII or container) instead of encrypting
+    const char *decrypt_output; // Binary plaintext written by --decrypt
+} Options;
+
+void print_usage(const char *program) {
+    printf("Usage: %s [--in-place] [--threads N] [--full-verify] [--checksum] [--mmap] [--stream MB] [--pipeline N] [--aio] [--direct] [--container]\n", program);
+    printf("       %s --decrypt CIPHERTEXT_FILE OUTPUT_FILE [--checksum] [--threads N]\n", program);
+    printf("  --in-place     Encrypt and decrypt in the input buffer\n");
+    printf("  --threads N    Encrypt with N threads from a persistent pool (0 = all available CPUs)\n");
+    printf("  --full-verify  Verify with a separate decryption pass and compare\n");
+    printf("                 (default: round trip checked inside the encryption pass)\n");
+    printf("  --checksum     Compute CRC32C of the plaintext and ciphertext during encryption\n");
+    printf("  --mmap         Map the input and output files and encrypt between them (no heap copies)\n");
+    printf("  --stream MB    Read, encrypt and write in MB-sized windows (constant memory, one pass)\n");
+    printf("  --pipeline N   Overlap reading, encryption on N threads (0 = all CPUs) and writing\n");
+    printf("                 (blocks are --stream MB, default 4 MB)\n");
+    printf("  --aio          Encrypt file to file with a deep io_uring queue (pread/pwrite fallback);\n");
+    printf("                 the ciphertext is written in binary to serial_encrypted_output.raw\n");
+    printf("  --direct       --aio bypassing the page cache (O_DIRECT, else posix_fadvise DONTNEED)\n");
+    printf("  --container    Encrypt on --threads N into an indexed binary container\n");
+    printf("                 (serial_encrypted_output.deac, --stream MB chunks, default 1 MB) and\n");
+    printf("                 decrypt it back chunk by chunk\n");
+    printf("  --decrypt IN OUT  Decrypt an ASCII-decimal ciphertext file (as written by this program or\n");
+    printf("                 mpi_dea) or a container file (on --threads N) into the binary plaintext OUT\n");
+}
+
+// Parse command-line options. Returns 0 on an unknown option.
+int parse_options(int argc, char *argv[], Options *opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->threads = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--in-place") == 0) {
+            opts->in_place = 1;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            opts->threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--full-verify") == 0) {
+            opts->full_verify = 1;
+        } else if (strcmp(argv[i], "--checksum") == 0) {
+            opts->checksum = 1;
+        } else if (strcmp(argv[i], "--mmap") == 0) {
+            opts->mmap_io = 1;
+        } else if (strcmp(argv[i], "--stream") == 0 && i + 1 < argc) {
+            int mb = atoi(argv[++i]);
+            opts->stream_window = (size_t)(mb > 0 ? mb : 16) * 1024 * 1024;
+        } else if (strcmp(argv[i], "--pipeline") == 0 && i + 1 < argc) {
+            int workers = atoi(argv[++i]);
+            opts->pipeline = 1;
+            opts->pipeline_workers = workers > 0 ? workers : 0;
+        } else if (strcmp(argv[i], "--aio") == 0) {
+            opts->aio = 1;
+        } else if (strcmp(argv[i], "--decrypt") == 0 && i + 2 < argc) {
+            opts->decrypt_input = argv[++i];
+            opts->decrypt_output = argv[++i];
+        } else if (strcmp(argv[i], "--direct") == 0) {
+            opts->aio = 1;
+            opts->direct = 1;
+        } else if (strcmp(argv[i], "--container") == 0) {
+            opts->container = 1;
+        } else {
+            printf("Unknown option: %s\n", argv[i]);
+            print_usage(argv[0]);
             return 0;
         }
     }
-    
-    fclose(file);
     return 1;
 }
 
-int main() {
-    DEA dea;
-    dea_init(&dea);
+// Streaming mode: the file goes through two window buffers (one being read
+// by a background thread, one being processed), so memory use is constant
+// whatever the file size. Each window is encrypted in its buffer at its
+// stream offset, appended to the ASCII output, decrypted back in place and
+// appended to the decrypted output. Runs one pass instead of the timing
+// iterations. Returns the process exit code.
+int run_streaming(const Options *opts, DEA_Pool *pool, const DEA_Plan *plan, const char *input_file,
+                  const char *encrypted_file, const char *decrypted_file) {
+    printf("Streaming window: %zu MB (double buffered)\n", opts->stream_window / (1024 * 1024));
+    
+    DEA_Stream *stream = dea_stream_open(input_file, opts->stream_window);
+    if (!stream) {
+        printf("Error: Could not open file %s\n", input_file);
+        return 1;
+    }
+    FILE *encrypted_out = fopen(encrypted_file, "w");
+    FILE *decrypted_out = fopen(decrypted_file, "wb");
+    if (!encrypted_out || !decrypted_out) {
+        printf("Error: Could not open output files for writing\n");
+        if (encrypted_out) fclose(encrypted_out);
+        if (decrypted_out) fclose(decrypted_out);
+        dea_stream_close(stream);
+        return 1;
+    }
+    
+    uint64_t read_cycles = 0, encrypt_cycles = 0, decrypt_cycles = 0, write_cycles = 0;
+    uint64_t start_cycles, end_cycles;
+    size_t mismatch = SIZE_MAX;
+    int write_success = 1;
+    uint32_t plain_crc = 0, decrypted_crc = 0;
+    DEA_Digest digest;
+    dea_digest_init(&digest);
+    
+    // The cursor carries the key phase from one window to the next
+    DEA_Cursor cursor;
+    dea_cursor_init(&cursor, plan, 0);
+    
+    uint8_t *window;
+    uint64_t offset;
+    size_t length;
+    for (;;) {
+        // Time spent waiting for the reader thread (zero when reads keep up)
+        start_cycles = get_cycles();
+        length = dea_stream_next(stream, &window, &offset);
+        end_cycles = get_cycles();
+        read_cycles += end_cycles - start_cycles;
+        if (length == 0) {
+            break;
+        }
+        if (offset == 0) {
+            print_data("Original (sample)", window, length);
+        }
+        
+        start_cycles = get_cycles();
+        if (opts->full_verify) {
+            plain_crc = dea_crc32c(plain_crc, window, length);
+        }
+        size_t bad = length;
+        if (opts->checksum) {
+            bad = dea_encrypt_digest_parallel(pool, plan, cursor.offset, window, length, window, &digest);
+        } else if (opts->full_verify) {
+            dea_encrypt_parallel(pool, plan, cursor.offset, window, length, window);
+        } else {
+            bad = dea_encrypt_verified_parallel(pool, plan, cursor.offset, window, length, window);
+        }
+        if (bad != length && mismatch == SIZE_MAX) {
+            mismatch = (size_t)offset + bad;
+        }
+        end_cycles = get_cycles();
+        encrypt_cycles += end_cycles - start_cycles;
+        
+        start_cycles = get_cycles();
+        if (!append_ascii(encrypted_out, window, length)) {
+            write_success = 0;
+        }
+        end_cycles = get_cycles();
+        write_cycles += end_cycles - start_cycles;
+        
+        // Decrypt back in place, advancing the cursor past this window
+        start_cycles = get_cycles();
+        dea_cursor_crypt(&cursor, window, length, window);
+        if (opts->full_verify) {
+            decrypted_crc = dea_crc32c(decrypted_crc, window, length);
+        }
+        end_cycles = get_cycles();
+        decrypt_cycles += end_cycles - start_cycles;
+        
+        start_cycles = get_cycles();
+        if (fwrite(window, 1, length, decrypted_out) != length) {
+            write_success = 0;
+        }
+        end_cycles = get_cycles();
+        write_cycles += end_cycles - start_cycles;
+    }
+    
+    size_t file_size = (size_t)cursor.offset;
+    int read_error = dea_stream_error(stream);
+    dea_stream_close(stream);
+    if (fclose(encrypted_out) != 0 || fclose(decrypted_out) != 0) {
+        write_success = 0;
+    }
+    
+    printf("Streamed %zu bytes\n", file_size);
+    if (read_error) {
+        printf("Error: Read failed after %zu bytes\n", file_size);
+    }
+    printf(write_success ? "Encrypted data (as ASCII decimal values) written to %s\n"
+                         : "Failed to write encrypted data to %s\n", encrypted_file);
+    printf(write_success ? "Decrypted data written to %s\n"
+                         : "Failed to write decrypted data to %s\n", decrypted_file);
+    if (opts->checksum) {
+        printf("Plaintext CRC32C:  %08X (%llu bytes)\n", digest.plain_crc, (unsigned long long)digest.length);
+        printf("Ciphertext CRC32C: %08X\n", digest.cipher_crc);
+    }
+    
+    int verified = mismatch == SIZE_MAX && !read_error;
+    if (opts->full_verify && plain_crc != decrypted_crc) {
+        verified = 0;
+    }
+    if (verified) {
+        printf("\nVerification SUCCESSFUL - The decrypted text matches the original!\n");
+    } else {
+        printf("\nVerification FAILED - The decrypted text does not match the original!\n");
+        if (mismatch != SIZE_MAX) {
+            printf("First mismatch at byte %zu\n", mismatch);
+        }
+    }
+    
+    uint64_t total_cycles = read_cycles + encrypt_cycles + decrypt_cycles + write_cycles;
+    if (file_size == 0 || total_cycles == 0) {
+        return verified ? 0 : 1;
+    }
+    printf("\n=== Performance Results (%zuMB file, streamed once) ===\n",
+           (file_size / (1024 * 1024)) + ((file_size % (1024 * 1024)) ? 1 : 0));
+    printf("Read wait:     %llu cycles (%.3f ms) (%.3f%% of total)\n",
+           (unsigned long long)read_cycles, cycles_to_ms(read_cycles), (double)read_cycles / total_cycles * 100.0);
+    printf("Encryption:    %llu cycles (%.3f ms) (%.3f%% of total)\n",
+           (unsigned long long)encrypt_cycles, cycles_to_ms(encrypt_cycles), (double)encrypt_cycles / total_cycles * 100.0);
+    printf("Decryption:    %llu cycles (%.3f ms) (%.3f%% of total)\n",
+           (unsigned long long)decrypt_cycles, cycles_to_ms(decrypt_cycles), (double)decrypt_cycles / total_cycles * 100.0);
+    printf("File write:    %llu cycles (%.3f ms) (%.3f%% of total)\n",
+           (unsigned long long)write_cycles, cycles_to_ms(write_cycles), (double)write_cycles / total_cycles * 100.0);
+    printf("Total:         %llu cycles (%.3f ms)\n",
+           (unsigned long long)total_cycles, cycles_to_ms(total_cycles));
+    
+    printf("\nCycles per byte:\n");
+    printf("Read wait:   %.2f cycles/byte\n", (double)read_cycles / file_size);
+    printf("Encryption:  %.2f cycles/byte\n", (double)encrypt_cycles / file_size);
+    printf("Decryption:  %.2f cycles/byte\n", (double)decrypt_cycles / file_size);
+    printf("File write:  %.2f cycles/byte\n", (double)write_cycles / file_size);
+    printf("Total:       %.2f cycles/byte\n", (double)total_cycles / file_size);
+    return verified ? 0 : 1;
+}
+
+// Pipeline stage callbacks. The reader fills a block from the input file;
+// the writer gets each encrypted block in stream order, appends it to the
+// ASCII output, decrypts it in place and appends it to the decrypted output.
+typedef struct {
+    const DEA_Plan *plan;
+    FILE *encrypted_out;
+    FILE *decrypted_out;
+    int full_verify;
+    uint32_t decrypted_crc;
+} PipelineOutput;
+
+size_t pipeline_read(void *ctx, uint8_t *buffer, size_t capacity) {
+    FILE *file = (FILE*)ctx;
+    size_t length = fread(buffer, 1, capacity, file);
+    if (length < capacity && ferror(file)) {
+        return (size_t)-1;
+    }
+    return length;
+}
+
+int pipeline_write(void *ctx, uint8_t *data, size_t length, uint64_t offset) {
+    PipelineOutput *out = (PipelineOutput*)ctx;
+    if (!append_ascii(out->encrypted_out, data, length)) {
+        return 0;
+    }
+    dea_crypt_at(out->plan, offset, data, length, data);
+    if (out->full_verify) {
+        out->decrypted_crc = dea_crc32c(out->decrypted_crc, data, length);
+    }
+    if (offset == 0) {
+        print_data("Decrypted (sample)", data, length);
+    }
+    return fwrite(data, 1, length, out->decrypted_out) == length;
+}
+
+// Pipeline mode: a reader thread, encryption workers and the writer (this
+// thread) run concurrently on a ring of blocks, so the run is bounded by the
+// slowest stage instead of the sum of read, encrypt and write. Reports how
+// busy each stage was. Returns the process exit code.
+int run_pipeline(const Options *opts, const DEA_Plan *plan, const char *input_file,
+                 const char *encrypted_file, const char *decrypted_file) {
+    DEA_PipelineConfig config;
+    memset(&config, 0, sizeof(config));
+    config.block_size = opts->stream_window;
+    config.workers = opts->pipeline_workers;
+    // The plaintext CRC of the digest is compared against the decrypted output
+    config.mode = (opts->checksum || opts->full_verify) ? DEA_PIPE_DIGEST : DEA_PIPE_VERIFY;
+    
+    FILE *input = fopen(input_file, "rb");
+    if (!input) {
+        printf("Error: Could not open file %s\n", input_file);
+        return 1;
+    }
+    PipelineOutput out;
+    memset(&out, 0, sizeof(out));
+    out.plan = plan;
+    out.full_verify = opts->full_verify;
+    out.encrypted_out = fopen(encrypted_file, "w");
+    out.decrypted_out = fopen(decrypted_file, "wb");
+    if (!out.encrypted_out || !out.decrypted_out) {
+        printf("Error: Could not open output files for writing\n");
+        if (out.encrypted_out) fclose(out.encrypted_out);
+        if (out.decrypted_out) fclose(out.decrypted_out);
+        fclose(input);
+        return 1;
+    }
+    
+    DEA_PipelineStats stats;
+    int ok = dea_pipeline_run(plan, &config, pipeline_read, input, pipeline_write, &out, &stats);
+    fclose(input);
+    if (fclose(out.encrypted_out) != 0 || fclose(out.decrypted_out) != 0) {
+        ok = 0;
+    }
+    
+    printf("Pipeline: 1 reader, %d encryption workers, 1 writer\n", stats.workers);
+    printf("Processed %llu bytes\n", (unsigned long long)stats.bytes);
+    printf(ok ? "Encrypted data (as ASCII decimal values) written to %s\n"
+              : "Pipeline failed; %s may be incomplete\n", encrypted_file);
+    printf(ok ? "Decrypted data written to %s\n"
+              : "Pipeline failed; %s may be incomplete\n", decrypted_file);
+    if (opts->checksum) {
+        printf("Plaintext CRC32C:  %08X (%llu bytes)\n", stats.digest.plain_crc,
+               (unsigned long long)stats.digest.length);
+        printf("Ciphertext CRC32C: %08X\n", stats.digest.cipher_crc);
+    }
+    
+    int verified = ok && stats.mismatch == UINT64_MAX;
+    if (opts->full_verify && stats.digest.plain_crc != out.decrypted_crc) {
+        verified = 0;
+    }
+    if (verified) {
+        printf("\nVerification SUCCESSFUL - The decrypted text matches the original!\n");
+    } else {
+        printf("\nVerification FAILED - The decrypted text does not match the original!\n");
+        if (stats.mismatch != UINT64_MAX) {
+            printf("First mismatch at byte %llu\n", (unsigned long long)stats.mismatch);
+        }
+    }
+    
+    if (stats.bytes == 0 || stats.seconds <= 0) {
+        return verified ? 0 : 1;
+    }
+    // A stage near 100% busy is the bottleneck; the others wait on it
+    printf("\n=== Pipeline Results (%lluMB file, one pass) ===\n",
+           (unsigned long long)((stats.bytes + 1024 * 1024 - 1) / (1024 * 1024)));
+    printf("Wall time:     %.3f ms\n", stats.seconds * 1000.0);
+    printf("Throughput:    %.1f MB/s\n", stats.bytes / stats.seconds / (1024.0 * 1024.0));
+    printf("Read busy:     %.1f%%\n", stats.read_busy * 100.0);
+    printf("Encrypt busy:  %.1f%% (mean over %d workers)\n", stats.encrypt_busy * 100.0, stats.workers);
+    printf("Write busy:    %.1f%%\n", stats.write_busy * 100.0);
+    return verified ? 0 : 1;
+}
+
+// Text read per fread by decrypt mode
+#define DECRYPT_CHUNK (4 * 1024 * 1024)
+// Longest unparsed value carried into the next chunk; more is malformed
+#define DECRYPT_CARRY 64
+
+// Decrypt mode: the ASCII-decimal ciphertext is read in chunks, parsed
+// back into bytes with dea_parse_decimal, decrypted in place at its stream
+// offset and written out as binary. A value cut by a chunk boundary is
+// carried over to the next chunk. Returns the process exit code.
+int run_decrypt(const Options *opts, const DEA_Plan *plan, const char *input_file, const char *output_file) {
+    FILE *input = fopen(input_file, "rb");
+    if (!input) {
+        printf("Error: Could not open file %s\n", input_file);
+        return 1;
+    }
+    FILE *output = fopen(output_file, "wb");
+    char *text = (char*)malloc(DECRYPT_CARRY + DECRYPT_CHUNK);
+    uint8_t *plain = (uint8_t*)malloc((DECRYPT_CARRY + DECRYPT_CHUNK) / 2 + 4);
+    if (!output || !text || !plain) {
+        printf(output ? "Memory allocation failed\n" : "Error: Could not open file %s for writing\n", output_file);
+        if (output) fclose(output);
+        fclose(input);
+        free(text);
+        free(plain);
+        return 1;
+    }
+    
+    uint64_t read_cycles = 0, parse_cycles = 0, decrypt_cycles = 0, write_cycles = 0;
+    uint64_t start_cycles, end_cycles;
+    uint64_t text_offset = 0;   // Characters of the file before text[0]
+    uint32_t crc = 0;
+    size_t carry = 0;
+    int ok = 1;
+    DEA_Cursor cursor;
+    dea_cursor_init(&cursor, plan, 0);
+    
+    for (;;) {
+        start_cycles = get_cycles();
+        size_t n = fread(text + carry, 1, DECRYPT_CHUNK, input);
+        end_cycles = get_cycles();
+        read_cycles += end_cycles - start_cycles;
+        if (n < DECRYPT_CHUNK && ferror(input)) {
+            printf("Error: Read failed at character %llu of %s\n", (unsigned long long)(text_offset + carry), input_file);
+            ok = 0;
+            break;
+        }
+        int final = n < DECRYPT_CHUNK;
+        
+        start_cycles = get_cycles();
+        size_t consumed;
+        size_t count = dea_parse_decimal(text, carry + n, final, plain, &consumed);
+        end_cycles = get_cycles();
+        parse_cycles += end_cycles - start_cycles;
+        if (count == (size_t)-1 || carry + n - consumed > DECRYPT_CARRY) {
+            printf("Error: Malformed ASCII data at character %llu of %s\n",
+                   (unsigned long long)(text_offset + consumed), input_file);
+            ok = 0;
+            break;
+        }
+        
+        start_cycles = get_cycles();
+        if (cursor.offset == 0 && count > 0) {
+            print_data("Ciphertext (sample)", plain, count);
+        }
+        dea_cursor_crypt(&cursor, plain, count, plain);
+        if (opts->checksum) {
+            crc = dea_crc32c(crc, plain, count);
+        }
+        end_cycles = get_cycles();
+        decrypt_cycles += end_cycles - start_cycles;
+        
+        start_cycles = get_cycles();
+        if (fwrite(plain, 1, count, output) != count) {
+            printf("Error: Could not write to %s\n", output_file);
+            ok = 0;
+        }
+        end_cycles = get_cycles();
+        write_cycles += end_cycles - start_cycles;
+        
+        carry = carry + n - consumed;
+        memmove(text, text + consumed, carry);
+        text_offset += consumed;
+        if (final || !ok) {
+            break;
+        }
+    }
+    
+    uint64_t text_size = text_offset + carry;
+    size_t file_size = (size_t)cursor.offset;
+    fclose(input);
+    if (fclose(output) != 0) {
+        ok = 0;
+    }
+    free(text);
+    free(plain);
+    if (!ok) {
+        return 1;
+    }
+    
+    printf("Decrypted %zu bytes from %llu characters of %s\n", file_size, (unsigned long long)text_size, input_file);
+    printf("Decrypted data written to %s\n", output_file);
+    if (opts->checksum) {
+        printf("Plaintext CRC32C:  %08X (%zu bytes)\n", crc, file_size);
+    }
+    
+    uint64_t total_cycles = read_cycles + parse_cycles + decrypt_cycles + write_cycles;
+    if (file_size == 0 || total_cycles == 0) {
+        return 0;
+    }
+    printf("\n=== Decrypt Results (%lluMB of ASCII text) ===\n",
+           (unsigned long long)((text_size + 1024 * 1024 - 1) / (1024 * 1024)));
+    printf("File read:     %llu cycles (%.3f ms) (%.3f%% of total)\n",
+           (unsigned long long)read_cycles, cycles_to_ms(read_cycles), (double)read_cycles / total_cycles * 100.0);
+    printf("Parsing:       %llu cycles (%.3f ms) (%.3f%% of total)\n",
+           (unsigned long long)parse_cycles, cycles_to_ms(parse_cycles), (double)parse_cycles / total_cycles * 100.0);
+    printf("Decryption:    %llu cycles (%.3f ms) (%.3f%% of total)\n",
+           (unsigned long long)decrypt_cycles, cycles_to_ms(decrypt_cycles), (double)decrypt_cycles / total_cycles * 100.0);
+    printf("File write:    %llu cycles (%.3f ms) (%.3f%% of total)\n",
+           (unsigned long long)write_cycles, cycles_to_ms(write_cycles), (double)write_cycles / total_cycles * 100.0);
+    printf("Total:         %llu cycles (%.3f ms)\n",
+           (unsigned long long)total_cycles, cycles_to_ms(total_cycles));
+    if (parse_cycles > 0) {
+        printf("Parse rate:    %.1f MB/s of text\n", text_size / (1024.0 * 1024.0) / (cycles_to_ms(parse_cycles) / 1000.0));
+    }
+    return 0;
+}
+
+// Asynchronous I/O mode: the input is encrypted file to file into a binary
+// ciphertext file, which is then decrypted file to file into the decrypted
+// output. Both passes keep a deep queue of block reads and writes in flight
+// from this thread. Returns the process exit code.
+int run_aio(const Options *opts, const DEA_Plan *plan, const char *input_file,
+            const char *encrypted_file, const char *decrypted_file) {
+    DEA_AioConfig config;
+    memset(&config, 0, sizeof(config));
+    config.block_size = opts->stream_window;
+    config.backend = DEA_AIO_AUTO;
+    config.direct = opts->direct;
+    // With --full-verify the plaintext CRC is compared against the decrypted file's
+    config.mode = (opts->checksum || opts->full_verify) ? DEA_PIPE_DIGEST : DEA_PIPE_VERIFY;
+    
+    DEA_AioStats encrypt_stats, decrypt_stats;
+    int ok = dea_aio_crypt_file(plan, input_file, encrypted_file, &config, &encrypt_stats);
+    if (!ok) {
+        printf("Error: Encrypting %s into %s failed\n", input_file, encrypted_file);
+        return 1;
+    }
+    printf("I/O backend: %s%s\n", dea_aio_backend_name(encrypt_stats.backend),
+           !opts->direct ? "" : encrypt_stats.direct ? ", O_DIRECT" : ", page cache dropped with posix_fadvise");
+    printf("Encrypted data (binary) written to %s\n", encrypted_file);
+    
+    ok = dea_aio_crypt_file(plan, encrypted_file, decrypted_file, &config, &decrypt_stats);
+    if (!ok) {
+        printf("Error: Decrypting %s into %s failed\n", encrypted_file, decrypted_file);
+        return 1;
+    }
+    printf("Decrypted data written to %s\n", decrypted_file);
+    if (opts->checksum) {
+        printf("Plaintext CRC32C:  %08X (%llu bytes)\n", encrypt_stats.digest.plain_crc,
+               (unsigned long long)encrypt_stats.digest.length);
+        printf("Ciphertext CRC32C: %08X\n", encrypt_stats.digest.cipher_crc);
+    }
+    
+    // The decryption pass's output side is the recovered plaintext
+    int verified = encrypt_stats.mismatch == UINT64_MAX && decrypt_stats.bytes == encrypt_stats.bytes;
+    if (opts->full_verify && decrypt_stats.digest.cipher_crc != encrypt_stats.digest.plain_crc) {
+        verified = 0;
+    }
+    if (verified) {
+        printf("\nVerification SUCCESSFUL - The decrypted text matches the original!\n");
+    } else {
+        printf("\nVerification FAILED - The decrypted text does not match the original!\n");
+        if (encrypt_stats.mismatch != UINT64_MAX) {
+            printf("First mismatch at byte %llu\n", (unsigned long long)encrypt_stats.mismatch);
+        }
+    }
+    
+    if (encrypt_stats.bytes == 0) {
+        return verified ? 0 : 1;
+    }
+    double mb = encrypt_stats.bytes / (1024.0 * 1024.0);
+    printf("\n=== Asynchronous I/O Results (%.0fMB file, file to file) ===\n", mb);
+    printf("Encrypt pass:  %.3f ms (%.1f MB/s read + written)\n",
+           encrypt_stats.seconds * 1000.0, encrypt_stats.seconds > 0 ? mb / encrypt_stats.seconds : 0.0);
+    printf("Decrypt pass:  %.3f ms (%.1f MB/s read + written)\n",
+           decrypt_stats.seconds * 1000.0, decrypt_stats.seconds > 0 ? mb / decrypt_stats.seconds : 0.0);
+    return verified ? 0 : 1;
+}
+
+// Reads per pass of run_random_reads
+#define RANDOM_READS 256
+#define RANDOM_READ_BYTES 4096
+
+// Read RANDOM_READS ranges at pseudo-random offsets through a DEA_Reader,
+// twice: the first pass decrypts the touched pages, the second is served
+// from the page cache. Every read is compared with the plaintext. Returns
+// 0 on a read error or mismatch.
+int run_random_reads(const DEA_Plan *plan, const char *path, const uint8_t *plaintext, size_t size) {
+    if (size == 0) {
+        return 1;
+    }
+    // 16 KB pages, enough of them for every page a pass can touch
+    DEA_Reader *reader = dea_reader_open(path, plan, 16 * 1024, 2 * RANDOM_READS);
+    if (!reader) {
+        printf("Error: Could not open %s for random reads\n", path);
+        return 0;
+    }
+    uint8_t buffer[RANDOM_READ_BYTES];
+    size_t length = size < RANDOM_READ_BYTES ? size : RANDOM_READ_BYTES;
+    int ok = 1;
+    uint64_t hits = 0, misses = 0;
+    for (int pass = 0; pass < 2 && ok; pass++) {
+        uint64_t hits_before = hits, misses_before = misses;
+        uint64_t seed = 12345;   // Same offsets in both passes
+        uint64_t start_cycles = get_cycles();
+        for (int i = 0; i < RANDOM_READS && ok; i++) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            uint64_t offset = (seed >> 16) % (size - length + 1);
+            ok = dea_reader_pread(reader, buffer, length, offset) == length &&
+                 memcmp(buffer, plaintext + offset, length) == 0;
+            if (!ok) {
+                printf("Random read of %zu bytes at offset %llu: MISMATCH\n", length, (unsigned long long)offset);
+            }
+        }
+        uint64_t read_cycles = get_cycles() - start_cycles;
+        dea_reader_stats(reader, &hits, &misses);
+        if (ok) {
+            printf("Random reads (%s): %d x %zu bytes in %.3f ms (%.2f us per read), %llu page hits, %llu decrypted\n",
+                   pass == 0 ? "cold" : "cached", RANDOM_READS, length, cycles_to_ms(read_cycles),
+                   cycles_to_ms(read_cycles) * 1000.0 / RANDOM_READS, (unsigned long long)(hits - hits_before),
+                   (unsigned long long)(misses - misses_before));
+        }
+    }
+    dea_reader_close(reader);
+    return ok;
+}
+
+// Container decrypt mode: the index is loaded, every chunk is read,
+// decrypted and checked against its CRC32C values by the pool workers, and
+// the plaintext lands directly in the mapped output file. Returns the
+// process exit code.
+int run_decrypt_container(const Options *opts, DEA_Pool *pool, const DEA_Plan *plan,
+                          const char *input_file, const char *output_file) {
+    DEA_Container container;
+    if (!dea_container_open(input_file, plan, &container)) {
+        printf("Error: %s is not a valid container for this key set\n", input_file);
+        return 1;
+    }
+    printf("Container: %llu bytes in %llu chunks of %llu bytes, %d keys\n",
+           (unsigned long long)container.length, (unsigned long long)container.num_chunks,
+           (unsigned long long)container.chunk_size, container.num_keys);
+    
+    DEA_Mapping output_map;
+    if (!dea_map_output(output_file, (size_t)container.length, &output_map)) {
+        printf("Error: Could not map file %s for writing\n", output_file);
+        dea_container_close(&container);
+        return 1;
+    }
+    uint64_t bad_chunk;
+    uint64_t start_cycles = get_cycles();
+    int ok = dea_container_decrypt(pool, &container, plan, output_map.data, &bad_chunk);
+    uint64_t decrypt_cycles = get_cycles() - start_cycles;
+    if (ok && output_map.data) {
+        print_data("Decrypted (sample)", output_map.data, output_map.size);
+    }
+    dea_unmap(&output_map);
+    
+    if (!ok) {
+        if (bad_chunk != UINT64_MAX) {
+            printf("Error: Chunk %llu of %s is unreadable or corrupt\n", (unsigned long long)bad_chunk, input_file);
+        } else {
+            printf("Error: Decrypting %s failed\n", input_file);
+        }
+        dea_container_close(&container);
+        return 1;
+    }
+    printf("Decrypted data written to %s (every chunk matched its CRC32C)\n", output_file);
+    if (opts->checksum) {
+        DEA_Digest digest;
+        dea_digest_init(&digest);
+        for (uint64_t i = 0; i < container.num_chunks; i++) {
+            DEA_Digest chunk = { container.index[i].plain_crc, container.index[i].cipher_crc, container.index[i].length };
+            dea_digest_merge(&digest, &chunk);
+        }
+        printf("Plaintext CRC32C:  %08X (%llu bytes)\n", digest.plain_crc, (unsigned long long)digest.length);
+    }
+    if (container.length > 0 && decrypt_cycles > 0) {
+        printf("Read + decrypt + check: %.3f ms (%.1f MB/s)\n", cycles_to_ms(decrypt_cycles),
+               container.length / (1024.0 * 1024.0) / (cycles_to_ms(decrypt_cycles) / 1000.0));
+    }
+    dea_container_close(&container);
+    return 0;
+}
+
+// Container mode: the mapped input is encrypted by the pool workers into an
+// indexed binary container (1 MB chunks, per-chunk digests in the footer
+// index), which is then decrypted back into the decrypted output file.
+// Random ranges are also read through the index with a DEA_Reader, which
+// decrypts only the pages they touch. Returns the process exit code.
+int run_container(const Options *opts, DEA_Pool *pool, const DEA_Plan *plan, const char *input_file,
+                  const char *container_file, const char *decrypted_file) {
+    DEA_Mapping input_map;
+    if (!dea_map_input(input_file, &input_map)) {
+        printf("Error: Could not map file %s\n", input_file);
+        return 1;
+    }
+    size_t file_size = input_map.size;
+    
+    DEA_Digest digest;
+    uint64_t start_cycles = get_cycles();
+    int ok = dea_container_write(pool, plan, container_file, input_map.data, file_size, opts->stream_window, &digest);
+    uint64_t write_cycles = get_cycles() - start_cycles;
+    if (!ok) {
+        printf("Error: Encrypting %s into %s failed\n", input_file, container_file);
+        dea_unmap(&input_map);
+        return 1;
+    }
+    printf("Encrypted data (indexed container) written to %s\n", container_file);
+    if (opts->checksum) {
+        printf("Plaintext CRC32C:  %08X (%llu bytes)\n", digest.plain_crc, (unsigned long long)digest.length);
+        printf("Ciphertext CRC32C: %08X\n", digest.cipher_crc);
+    }
+    
+    // Random access through the index, with a cache of decrypted pages
+    DEA_Container container;
+    int verified = dea_container_open(container_file, plan, &container);
+    if (!verified) {
+        printf("Error: Could not open container %s\n", container_file);
+    } else if (!run_random_reads(plan, container_file, input_map.data, file_size)) {
+        verified = 0;
+    }
+    
+    start_cycles = get_cycles();
+    int status = run_decrypt_container(opts, pool, plan, container_file, decrypted_file);
+    uint64_t read_cycles = get_cycles() - start_cycles;
+    if (status != 0) {
+        verified = 0;
+    }
+    
+    // Chunk checksums already prove the round trip; --full-verify also compares bytes
+    if (verified && opts->full_verify && file_size > 0) {
+        DEA_Mapping decrypted_map;
+        verified = dea_map_input(decrypted_file, &decrypted_map) && decrypted_map.size == file_size &&
+                   memcmp(decrypted_map.data, input_map.data, file_size) == 0;
+        dea_unmap(&decrypted_map);
+    }
+    if (verified) {
+        printf("\nVerification SUCCESSFUL - The decrypted text matches the original!\n");
+    } else {
+        printf("\nVerification FAILED - The decrypted text does not match the original!\n");
+    }
+    
+    if (container.index) {
+        uint64_t container_size = DEA_CONTAINER_HEADER + container.length +
+                                  container.num_chunks * DEA_CONTAINER_ENTRY + DEA_CONTAINER_TRAILER;
+        printf("\n=== Container Results (%zu byte file) ===\n", file_size);
+        printf("Container size: %llu bytes (ASCII output would be about %zu)\n",
+               (unsigned long long)container_size, file_size * 4);
+        printf("Encrypt + write: %.3f ms\n", cycles_to_ms(write_cycles));
+        printf("Open + decrypt:  %.3f ms\n", cycles_to_ms(read_cycles));
+        dea_container_close(&container);
+    }
+    dea_unmap(&input_map);
+    return verified ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    Options opts;
+    if (!parse_options(argc, argv, &opts)) {
+        return 1;
+    }
     
     printf("=== Serial Multi-Key DEA Encryption Test ===\n\n");
     
     // Input/output file names
-    const char* input_file = "test_input.txt";
+    const char* input_file = opts.decrypt_input ? opts.decrypt_input : "test_input.txt";
     const char* encrypted_file = "serial_encrypted_output.bin";
     const char* decrypted_file = "serial_decrypted_output.txt";
     
@@ -138,25 +861,136 @@ int main() {
     
     printf("Input file: %s\n", input_file);
     printf("Number of iterations for encryption: %d\n", num_iterations);
+    printf("Encryption kernel: %s\n", dea_kernel_name());
+    if (opts.decrypt_input && (opts.mmap_io || opts.in_place || opts.pipeline || opts.aio ||
+                               opts.container || opts.stream_window || opts.full_verify)) {
+        printf("Note: only --checksum and --threads (for container files) apply with --decrypt\n");
+        opts.mmap_io = opts.in_place = opts.pipeline = opts.aio = opts.direct = opts.full_verify = 0;
+        opts.container = 0;
+        opts.stream_window = 0;
+    }
+    if (opts.container && (opts.mmap_io || opts.in_place || opts.pipeline || opts.aio)) {
+        // Chunks are encrypted from the mapped input into per-worker buffers
+        printf("Note: --in-place, --mmap, --pipeline and --aio have no effect with --container\n");
+        opts.mmap_io = opts.in_place = opts.pipeline = opts.aio = opts.direct = 0;
+    }
+    if (opts.aio && (opts.mmap_io || opts.in_place || opts.threads != 1 || opts.pipeline)) {
+        // One thread drives the I/O queue and encrypts each block in place
+        printf("Note: --in-place, --mmap, --threads and --pipeline have no effect with --aio\n");
+        opts.mmap_io = 0;
+        opts.in_place = 0;
+        opts.threads = 1;
+        opts.pipeline = 0;
+    }
+    if (opts.pipeline && (opts.mmap_io || opts.in_place || opts.threads != 1)) {
+        // The pipeline has its own workers and works in place on its blocks
+        printf("Note: --in-place, --mmap and --threads have no effect with --pipeline\n");
+        opts.mmap_io = 0;
+        opts.in_place = 0;
+        opts.threads = 1;
+    }
+    if (opts.stream_window && !opts.pipeline && (opts.mmap_io || opts.in_place)) {
+        // Streaming always works in place on its window buffers
+        printf("Note: --in-place and --mmap have no effect with --stream\n");
+        opts.mmap_io = 0;
+        opts.in_place = 0;
+    }
+    if (opts.mmap_io && opts.in_place) {
+        // The mapped input is read-only; the output mapping is the only buffer anyway
+        printf("Note: --in-place has no effect with --mmap\n");
+        opts.in_place = 0;
+    }
+    printf("Buffer mode: %s\n", opts.decrypt_input ? "decrypt ciphertext file" :
+                                 opts.container ? "indexed container file" :
+                                 opts.aio ? "asynchronous file to file" :
+                                 opts.pipeline ? "pipelined blocks" :
+                                 opts.stream_window ? "streaming windows" :
+                                 opts.mmap_io ? "memory-mapped files" :
+                                 opts.in_place ? "in-place" : "separate output buffer");
+    printf("Verification: %s\n", opts.full_verify ? (opts.stream_window || opts.pipeline || opts.aio ? "decryption pass, CRC32C compared"
+                                                                         : "separate decryption pass")
+                                                   : "fused with encryption");
+    
+    // Thread pool, created once and reused for every encryption pass
+    DEA_Pool *pool = NULL;
+    if (opts.threads != 1) {
+        pool = dea_pool_create(opts.threads);
+        if (!pool) {
+            printf("Failed to create thread pool, running serially\n");
+        }
+    }
+    printf("Threads: %d\n", dea_pool_threads(pool));
     
     // Set up 4 different keys (same as your MPI implementation)
     printf("Setting up 4 encryption keys...\n");
-    dea_reset(&dea);
-    dea_set_key(&dea, 0xAA);
-    dea_set_key(&dea, 0xBB);
-    dea_set_key(&dea, 0xCC);
-    dea_set_key(&dea, 0xDD);
+    const uint8_t keys[4] = { 0xAA, 0xBB, 0xCC, 0xDD };
+    DEA_Plan *plan = dea_plan_create(keys, 4);
+    if (!plan) {
+        printf("Failed to create key plan\n");
+        dea_pool_destroy(pool);
+        return 1;
+    }
+    
+    if (opts.decrypt_input) {
+        int status = dea_container_probe(input_file)
+                         ? run_decrypt_container(&opts, pool, plan, input_file, opts.decrypt_output)
+                         : run_decrypt(&opts, plan, input_file, opts.decrypt_output);
+        dea_pool_destroy(pool);
+        dea_plan_destroy(plan);
+        return status;
+    }
+    if (opts.container) {
+        int status = run_container(&opts, pool, plan, input_file, "serial_encrypted_output.deac", decrypted_file);
+        dea_pool_destroy(pool);
+        dea_plan_destroy(plan);
+        return status;
+    }
+    if (opts.aio) {
+        // Binary ciphertext: ASCII formatting could not keep up with the disk
+        int status = run_aio(&opts, plan, input_file, "serial_encrypted_output.raw", decrypted_file);
+        dea_pool_destroy(pool);
+        dea_plan_destroy(plan);
+        return status;
+    }
+    if (opts.pipeline) {
+        int status = run_pipeline(&opts, plan, input_file, encrypted_file, decrypted_file);
+        dea_pool_destroy(pool);
+        dea_plan_destroy(plan);
+        return status;
+    }
+    if (opts.stream_window) {
+        int status = run_streaming(&opts, pool, plan, input_file, encrypted_file, decrypted_file);
+        dea_pool_destroy(pool);
+        dea_plan_destroy(plan);
+        return status;
+    }
     
     // Load the input file with timing
     printf("Loading input file...\n");
     size_t file_size = 0;
+    DEA_Mapping input_map, output_map;
     uint64_t start_cycles = get_cycles();
-    uint8_t *input_data = (uint8_t*)load_file(input_file, &file_size);
+    uint8_t *input_data;
+    uint8_t empty_file[1] = { 0 };   // Stands in for the (absent) mappings of a 0-byte file
+    if (opts.mmap_io) {
+        // Pages are read on first touch, so loading is only the mapping itself
+        input_data = NULL;
+        if (dea_map_input(input_file, &input_map)) {
+            input_data = input_map.data ? input_map.data : empty_file;
+            file_size = input_map.size;
+        } else {
+            printf("Error: Could not map file %s\n", input_file);
+        }
+    } else {
+        input_data = (uint8_t*)load_file(input_file, &file_size);
+    }
     uint64_t end_cycles = get_cycles();
     load_cycles = end_cycles - start_cycles;
     
     if (!input_data) {
         printf("Failed to load input file\n");
+        dea_pool_destroy(pool);
+        dea_plan_destroy(plan);
         return 1;
     }
     
@@ -166,19 +1000,39 @@ int main() {
     
     print_data("Original (sample)", input_data, file_size);
     
-    // Allocate memory for encrypted and decrypted data
-    uint8_t *encrypted = malloc(file_size);
-    uint8_t *decrypted = malloc(file_size + 1);  // +1 for null terminator
-    
-    if (!encrypted || !decrypted) {
-        printf("Memory allocation failed\n");
-        free(input_data);
-        return 1;
+    // The ciphertext is produced directly in its final buffer, and decryption
+    // then runs in place on it. In in-place mode that buffer is the input
+    // itself, so only one full-size buffer exists.
+    uint8_t *encrypted = input_data;
+    uint32_t original_checksum = 0;
+    if (opts.in_place && opts.full_verify) {
+        original_checksum = dea_crc32c(0, input_data, file_size);
+    }
+    if (opts.mmap_io) {
+        // The ciphertext is produced in the mapped output file and decrypted
+        // there, so the file holds the plaintext when it is unmapped
+        if (!dea_map_output(decrypted_file, file_size, &output_map)) {
+            printf("Error: Could not map file %s for writing\n", decrypted_file);
+            dea_unmap(&input_map);
+            dea_pool_destroy(pool);
+            dea_plan_destroy(plan);
+            return 1;
+        }
+        encrypted = output_map.data ? output_map.data : empty_file;
+    } else if (!opts.in_place) {
+        encrypted = malloc(file_size);
+        if (!encrypted) {
+            printf("Memory allocation failed\n");
+            free(input_data);
+            dea_pool_destroy(pool);
+            dea_plan_destroy(plan);
+            return 1;
+        }
     }
     
     // Run a small encryption to warm up the cache
-    dea_reset(&dea);
-    dea_encrypt_block(&dea, input_data, 1024 < file_size ? 1024 : file_size, encrypted);
+    uint8_t warmup[1024];
+    dea_crypt_at(plan, 0, input_data, 1024 < file_size ? 1024 : file_size, warmup);
     
     // Start the encryption benchmark
     printf("\nStarting encryption benchmark (%zu bytes × %d iterations)...\n", 
@@ -186,56 +1040,112 @@ int main() {
     
     encrypt_cycles = 0;
     
-    // Multiple iterations for more accurate timing
+    // Multiple iterations for more accurate timing. In place, each pass
+    // toggles the buffer between plaintext and ciphertext. By default every
+    // pass also verifies its round trip while the data is still in L1.
+    // With --checksum the pass also digests both sides; the first pass is
+    // the one whose input is the original plaintext.
+    size_t mismatch = file_size;
+    DEA_Digest digest;
+    dea_digest_init(&digest);
     for (int j = 0; j < num_iterations; j++) {
-        dea_reset(&dea);
         start_cycles = get_cycles();
-        dea_encrypt_block(&dea, input_data, file_size, encrypted);
+        if (opts.checksum) {
+            DEA_Digest pass;
+            dea_digest_init(&pass);
+            size_t bad = dea_encrypt_digest_parallel(pool, plan, 0, input_data, file_size, encrypted, &pass);
+            if (bad < mismatch) {
+                mismatch = bad;
+            }
+            if (j == 0) {
+                digest = pass;
+            }
+        } else if (opts.full_verify) {
+            dea_encrypt_parallel(pool, plan, 0, input_data, file_size, encrypted);
+        } else {
+            size_t bad = dea_encrypt_verified_parallel(pool, plan, 0, input_data, file_size, encrypted);
+            if (bad < mismatch) {
+                mismatch = bad;
+            }
+        }
         end_cycles = get_cycles();
         encrypt_cycles += (end_cycles - start_cycles);
     }
+    if (opts.in_place && num_iterations % 2 == 0) {
+        dea_encrypt_parallel(pool, plan, 0, encrypted, file_size, encrypted);
+    }
     
     // Calculate average encryption time
     encrypt_cycles /= num_iterations;
     
     // Show a sample of the encrypted data
     print_data("Encrypted (sample)", encrypted, file_size);
+    if (opts.checksum) {
+        printf("Plaintext CRC32C:  %08X (%llu bytes)\n", digest.plain_crc, (unsigned long long)digest.length);
+        printf("Ciphertext CRC32C: %08X\n", digest.cipher_crc);
+    }
     
-    // Verify with decryption
-    printf("\nPerforming decryption...\n");
-    dea_reset(&dea);
-    
+    // Write the encrypted data as ASCII decimal values before it is decrypted in place
+    printf("\nWriting encrypted output...\n");
     start_cycles = get_cycles();
-    dea_decrypt_block(&dea, encrypted, file_size, decrypted);
+    int write_success = 1;
+    
+    if (write_file_as_ascii(pool, encrypted_file, encrypted, file_size)) {
+        printf("Encrypted data (as ASCII decimal values) written to %s\n", encrypted_file);
+    } else {
+        printf("Failed to write encrypted data\n");
+        write_success = 0;
+    }
+    
     end_cycles = get_cycles();
-    decrypt_cycles = end_cycles - start_cycles;
+    write_cycles = end_cycles - start_cycles;
     
-    decrypted[file_size] = '\0';
+    // Decrypt in place when the plaintext is needed again: for the separate
+    // verification pass, to recover it in in-place mode, or to leave it in
+    // the mapped output file. Otherwise the fused kernel has already proven
+    // the round trip and the input buffer is the decrypted text.
+    uint8_t *decrypted = input_data;
+    decrypt_cycles = 0;
+    if (opts.full_verify || opts.in_place || opts.mmap_io) {
+        printf("\nPerforming decryption...\n");
+        start_cycles = get_cycles();
+        dea_encrypt_parallel(pool, plan, 0, encrypted, file_size, encrypted);
+        end_cycles = get_cycles();
+        decrypt_cycles = end_cycles - start_cycles;
+        decrypted = encrypted;
+    }
     
     print_data("Decrypted (sample)", decrypted, file_size);
     
     // Verify correctness
-    if (memcmp(input_data, decrypted, file_size) == 0) {
+    int verified;
+    if (opts.full_verify) {
+        verified = opts.in_place ? dea_crc32c(0, decrypted, file_size) == original_checksum
+                                 : memcmp(input_data, decrypted, file_size) == 0;
+    } else {
+        verified = mismatch == file_size;
+    }
+    if (opts.full_verify && opts.checksum && mismatch != file_size) {
+        verified = 0;
+    }
+    if (verified) {
         printf("\nVerification SUCCESSFUL - The decrypted text matches the original!\n");
     } else {
         printf("\nVerification FAILED - The decrypted text does not match the original!\n");
+        if (mismatch != file_size) {
+            printf("First mismatch at byte %zu\n", mismatch);
+        }
     }
     
-    // Write encrypted and decrypted data to files
-    printf("\nWriting output files...\n");
+    // Write decrypted data as normal text
+    printf("\nWriting decrypted output...\n");
     start_cycles = get_cycles();
-    int write_success = 1;
-    
-    // Write encrypted data as ASCII decimal values
-    if (write_file_as_ascii(encrypted_file, encrypted, file_size)) {
-        printf("Encrypted data (as ASCII decimal values) written to %s\n", encrypted_file);
-    } else {
-        printf("Failed to write encrypted data\n");
-        write_success = 0;
-    }
     
-    // Write decrypted data as normal text
-    if (write_file(decrypted_file, decrypted, file_size)) {
+    if (opts.mmap_io) {
+        // Already in the page cache of the output file; the OS writes it back
+        dea_unmap(&output_map);
+        printf("Decrypted data mapped to %s\n", decrypted_file);
+    } else if (write_file(decrypted_file, decrypted, file_size)) {
         printf("Decrypted data written to %s\n", decrypted_file);
     } else {
         printf("Failed to write decrypted data\n");
@@ -243,7 +1153,7 @@ int main() {
     }
     
     end_cycles = get_cycles();
-    write_cycles = end_cycles - start_cycles;
+    write_cycles += end_cycles - start_cycles;
     
     // Calculate total time
     total_cycles = load_cycles + encrypt_cycles + decrypt_cycles + write_cycles;
@@ -280,9 +1190,16 @@ int main() {
     printf("Total:       %.2f cycles/byte\n", (double)total_cycles / file_size);
 
     // Cleanup
-    free(input_data);
-    free(encrypted);
-    free(decrypted);
+    if (opts.mmap_io) {
+        dea_unmap(&input_map);
+    } else {
+        if (encrypted != input_data) {
+            free(encrypted);
+        }
+        free(input_data);
+    }
+    dea_pool_destroy(pool);
+    dea_plan_destroy(plan);
     
     return 0;
 }
\ No newline at end of file